@@ -1,231 +1,349 @@
 #include "GLWidget.h"
 
-void GLWidget::clear() {
-  brect_initialized_ = false;
-  point_data_.clear();
-  segment_data_.clear();
-  vd_.clear();
-
-  polygon_data_.clear();
-  disjoint_idx_.clear();
-  combined_polygon_set_.clear();
-  ordered_pairs_.clear();
-}
-
-void GLWidget::read_data(const QString& file_path) {
-  QFile data(file_path);
-  if (!data.open(QFile::ReadOnly)) {
-    QMessageBox::warning(
-        this, tr("Voronoi Visualizer"),
-        tr("Disable to open file ") + file_path);
-  }
-  QTextStream in_stream(&data);
-  std::size_t num_points, num_segments;
-  int x1, y1, x2, y2;
-  in_stream >> num_points;
-  for (std::size_t i = 0; i < num_points; ++i) {
-    in_stream >> x1 >> y1;
-    point_type p(x1, y1);
-    update_brect(p);
-    point_data_.push_back(p);
-  }
-  in_stream >> num_segments;
-  point_type first;
-  bool isFirst = true;
-  for (std::size_t i = 0; i < num_segments; ++i) {
-    in_stream >> x1 >> y1 >> x2 >> y2;
-    point_type lp(x1, y1);
-    point_type hp(x2, y2);
-    if (isFirst)
-    {
-        first = lp;
-        isFirst = false;
+#include <algorithm>
+#include <cmath>
+
+void GLWidget::construct_brect(
+    const LayoutClassifier& layout, view_rect* brect, view_point* shift) {
+  const rect_type& bounds = layout.brect();
+  *brect = view_rect(xl(bounds), yl(bounds), xh(bounds), yh(bounds));
+  double side = (std::max)(xh(*brect) - xl(*brect), yh(*brect) - yl(*brect));
+  center(*shift, *brect);
+  set_points(*brect, *shift, *shift);
+  bloat(*brect, side * 1.2);
+}
+
+void GLWidget::update_view_port() {
+  glMatrixMode(GL_PROJECTION);
+  glLoadIdentity();
+  view_rect view_rect = view_rect_;
+  deconvolve(view_rect, shift_);
+  glOrtho(xl(view_rect), xh(view_rect),
+          yl(view_rect), yh(view_rect),
+          -1.0, 1.0);
+  glMatrixMode(GL_MODELVIEW);
+}
+
+void GLWidget::add_item(const index_box& bounds, GLuint first, GLuint count,
+                        std::vector<std::pair<index_box, std::size_t> >* items,
+                        culling_index* target) {
+  items->push_back(std::make_pair(bounds, target->ranges.size()));
+  draw_range range = {first, count};
+  target->ranges.push_back(range);
+}
+
+void GLWidget::push_vertex(const view_point& shift, double x, double y,
+                           std::vector<GLfloat>* vertices) {
+  vertices->push_back(static_cast<GLfloat>(x - shift.x()));
+  vertices->push_back(static_cast<GLfloat>(y - shift.y()));
+}
+
+void GLWidget::collect_vertices(build_result* result) {
+  trace_scope trace("collect_vertices");
+  const std::vector<point_type>& points = result->layout->point_data();
+  const std::vector<segment_type>& segments = result->layout->segment_data();
+  const std::vector<int>& contour_end = result->layout->contour_end();
+  std::vector<std::pair<index_box, std::size_t> > items;
+
+  std::vector<GLfloat>& point_vertices = result->point_vertices;
+  point_vertices.clear();
+  point_vertices.reserve(2 * points.size());
+  items.reserve(points.size());
+  for (const auto& point : points) {
+    index_point corner(point.x(), point.y());
+    add_item(index_box(corner, corner),
+             static_cast<GLuint>(point_vertices.size() / 2), 1,
+             &items, &result->points);
+    push_vertex(result->shift, point.x(), point.y(), &point_vertices);
+  }
+  // packing on construction gives a better tree than inserting one by one.
+  result->points.index = range_index(items.begin(), items.end());
+
+  std::vector<GLfloat>& segment_vertices = result->segment_vertices;
+  std::vector<GLfloat>& lod_vertices = result->lod_vertices;
+  segment_vertices.clear();
+  segment_vertices.reserve(4 * segments.size());
+  lod_vertices.clear();
+  lod_vertices.reserve(2 * contour_end.size() + 2);
+  items.clear();
+  items.reserve(contour_end.size() + 1);
+  std::size_t next_contour = 0;
+  std::size_t begin = 0;
+  for (std::size_t i = 0; i < segments.size(); ++i) {
+    const segment_type& segment = segments[i];
+    push_vertex(result->shift, low(segment).x(), low(segment).y(),
+                &segment_vertices);
+    push_vertex(result->shift, high(segment).x(), high(segment).y(),
+                &segment_vertices);
+    bool closed = next_contour < contour_end.size() &&
+                  contour_end[next_contour] == static_cast<int>(i);
+    if (!closed && i + 1 != segments.size()) {
+      continue;
+    }
+    index_box bounds(index_point(low(segments[begin]).x(),
+                               low(segments[begin]).y()),
+                    index_point(low(segments[begin]).x(),
+                               low(segments[begin]).y()));
+    for (std::size_t j = begin; j <= i; ++j) {
+      boost::geometry::expand(
+          bounds, index_point(high(segments[j]).x(), high(segments[j]).y()));
     }
-    if (first == hp)
-    {
-        disjoint_idx_.emplace_back(i);
-        isFirst = true;
+    add_item(bounds, static_cast<GLuint>(2 * begin),
+             static_cast<GLuint>(2 * (i + 1 - begin)),
+             &items, &result->contours);
+    index_point middle;
+    boost::geometry::centroid(bounds, middle);
+    push_vertex(result->shift, middle.get<0>(), middle.get<1>(),
+                &lod_vertices);
+    if (closed) {
+      ++next_contour;
     }
-    update_brect(lp);
-    update_brect(hp);
-    segment_data_.push_back(segment_type(lp, hp));
+    begin = i + 1;
   }
-  in_stream.flush();
+  result->contours.index = range_index(items.begin(), items.end());
 }
 
-void GLWidget::update_brect(const point_type& point) {
-  if (brect_initialized_) {
-    encompass(brect_, point);
-  } else {
-    set_points(brect_, point, point);
-    brect_initialized_ = true;
+void GLWidget::upload(const std::vector<GLfloat>& vertices,
+                      QGLBuffer* target) {
+  if (!target->isCreated()) {
+    target->create();
+    target->setUsagePattern(QGLBuffer::StaticDraw);
   }
+  target->bind();
+  target->allocate(vertices.empty() ? NULL : &vertices[0],
+                   static_cast<int>(vertices.size() * sizeof(GLfloat)));
+  target->release();
 }
 
-void GLWidget::construct_brect() {
-  double side = (std::max)(xh(brect_) - xl(brect_), yh(brect_) - yl(brect_));
-  center(shift_, brect_);
-  set_points(brect_, shift_, shift_);
-  bloat(brect_, side * 1.2);
+void GLWidget::merge_ranges(std::vector<draw_range>* ranges) {
+  if (ranges->empty()) {
+    return;
+  }
+  std::sort(ranges->begin(), ranges->end(),
+            [](const draw_range& a, const draw_range& b) {
+              return a.first < b.first;
+            });
+  std::size_t last = 0;
+  for (std::size_t i = 1; i < ranges->size(); ++i) {
+    draw_range& merged = (*ranges)[last];
+    const draw_range& next = (*ranges)[i];
+    if (merged.first + merged.count == next.first) {
+      merged.count += next.count;
+    } else {
+      (*ranges)[++last] = next;
+    }
+  }
+  ranges->resize(last + 1);
 }
 
-void GLWidget::color_exterior(const VD::edge_type* edge) {
-  if (edge->color() == EXTERNAL_COLOR) {
+void GLWidget::draw_ranges(QGLBuffer* source, GLenum mode,
+                           const std::vector<draw_range>& ranges) {
+  if (ranges.empty()) {
     return;
   }
-  edge->color(EXTERNAL_COLOR);
-  edge->twin()->color(EXTERNAL_COLOR);
-  const VD::vertex_type* v = edge->vertex1();
-  if (v == NULL || !edge->is_primary()) {
-    return;
+  // glMultiDrawArrays would take them in one call, but it is not exported
+  // by every GL library the widget links against.
+  source->bind();
+  glEnableClientState(GL_VERTEX_ARRAY);
+  glVertexPointer(2, GL_FLOAT, 0, NULL);
+  for (const auto& range : ranges) {
+    glDrawArrays(mode, static_cast<GLint>(range.first),
+                 static_cast<GLsizei>(range.count));
   }
-  v->color(EXTERNAL_COLOR);
-  const VD::edge_type* e = v->incident_edge();
-  do {
-    color_exterior(e);
-    e = e->rot_next();
-  } while (e != v->incident_edge());
+  glDisableClientState(GL_VERTEX_ARRAY);
+  source->release();
 }
 
-void GLWidget::update_view_port() {
-  glMatrixMode(GL_PROJECTION);
-  glLoadIdentity();
-  rect_type view_rect = brect_;
-  deconvolve(view_rect, shift_);
-  glOrtho(xl(view_rect), xh(view_rect),
-          yl(view_rect), yh(view_rect),
-          -1.0, 1.0);
-  glMatrixMode(GL_MODELVIEW);
+void GLWidget::collect_visible() {
+  visible_points_.clear();
+  visible_segments_.clear();
+  visible_lods_.clear();
+  visible_fill_.clear();
+  visible_fill_lods_.clear();
+  index_box visible(index_point(xl(view_rect_), yl(view_rect_)),
+                   index_point(xh(view_rect_), yh(view_rect_)));
+  double pixel = (xh(view_rect_) - xl(view_rect_)) / viewport_side_;
+  auto below_pixel = [pixel](const index_box& bounds) {
+    const index_point& low = bounds.min_corner();
+    const index_point& high = bounds.max_corner();
+    return high.get<0>() - low.get<0>() < pixel &&
+           high.get<1>() - low.get<1>() < pixel;
+  };
+  auto lod = [](const culling_index& items, std::size_t item) {
+    draw_range range = {items.lod_first + static_cast<GLuint>(item), 1};
+    return range;
+  };
+
+  namespace bgi = boost::geometry::index;
+  for (auto it = points_.index.qbegin(bgi::intersects(visible));
+       it != points_.index.qend(); ++it) {
+    visible_points_.push_back(points_.ranges[it->second]);
+  }
+  for (auto it = contours_.index.qbegin(bgi::intersects(visible));
+       it != contours_.index.qend(); ++it) {
+    if (below_pixel(it->first)) {
+      visible_lods_.push_back(lod(contours_, it->second));
+    } else {
+      visible_segments_.push_back(contours_.ranges[it->second]);
+    }
+  }
+  for (auto it = regions_.index.qbegin(bgi::intersects(visible));
+       it != regions_.index.qend(); ++it) {
+    if (below_pixel(it->first)) {
+      visible_fill_lods_.push_back(lod(regions_, it->second));
+    } else {
+      visible_fill_.push_back(regions_.ranges[it->second]);
+    }
+  }
+  merge_ranges(&visible_points_);
+  merge_ranges(&visible_segments_);
+  merge_ranges(&visible_lods_);
+  merge_ranges(&visible_fill_);
+  merge_ranges(&visible_fill_lods_);
+}
+
+GLWidget::view_point GLWidget::to_layout(const QPoint& pos) const {
+  double pixel = (xh(view_rect_) - xl(view_rect_)) / viewport_side_;
+  return view_point(xl(view_rect_) + (pos.x() - viewport_x_) * pixel,
+                    yh(view_rect_) - (pos.y() - viewport_y_) * pixel);
 }
 
 void GLWidget::draw_points() {
   // Draw input points and endpoints of the input segments.
   glColor3f(0.0f, 0.5f, 1.0f);
   glPointSize(9);
-  glBegin(GL_POINTS);
-  for (std::size_t i = 0; i < point_data_.size(); ++i) {
-    point_type point = point_data_[i];
-    deconvolve(point, shift_);
-    glVertex2f(point.x(), point.y());
-  }
-  for (std::size_t i = 0; i < segment_data_.size(); ++i) {
-    point_type lp = low(segment_data_[i]);
-    lp = deconvolve(lp, shift_);
-    glVertex2f(lp.x(), lp.y());
-    point_type hp = high(segment_data_[i]);
-    hp = deconvolve(hp, shift_);
-    glVertex2f(hp.x(), hp.y());
-  }
-  glEnd();
+  draw_ranges(&point_buffer_, GL_POINTS, visible_points_);
+  draw_ranges(&segment_buffer_, GL_POINTS, visible_segments_);
+  // contours below a pixel are a dot each.
+  glPointSize(2);
+  draw_ranges(&lod_buffer_, GL_POINTS, visible_lods_);
 }
 
 void GLWidget::draw_segments() {
   // Draw input segments.
   glColor3f(0.0f, 0.5f, 1.0f);
   glLineWidth(2.7f);
-  glBegin(GL_LINES);
-  for (std::size_t i = 0; i < segment_data_.size(); ++i) {
-    point_type lp = low(segment_data_[i]);
-    lp = deconvolve(lp, shift_);
-    glVertex2f(lp.x(), lp.y());
-    point_type hp = high(segment_data_[i]);
-    hp = deconvolve(hp, shift_);
-    glVertex2f(hp.x(), hp.y());
-  }
-  glEnd();
+  draw_ranges(&segment_buffer_, GL_LINES, visible_segments_);
 }
 
-void GLWidget::draw_vertices() {
+void GLWidget::triangulate_fill(build_result* result) {
+  trace_scope trace("triangulate_fill");
+  std::vector<GLfloat>& fill_vertices = result->fill_vertices;
+  fill_vertices.clear();
+  std::vector<GLfloat>& lod_vertices = result->lod_vertices;
+  result->regions.lod_first = static_cast<GLuint>(lod_vertices.size() / 2);
+  std::vector<std::pair<index_box, std::size_t> > items;
+  std::vector<std::vector<point_type>> rings;
+  std::vector<point_type> triangles;
+  for (const auto& region : result->layout->combined_polygon_set()) {
+    rings.resize(1);
+    rings[0].assign(region.begin(), region.end());
+    for (auto it = region.begin_holes(); it != region.end_holes(); ++it) {
+      rings.push_back(std::vector<point_type>(it->begin(), it->end()));
+    }
+    triangles.clear();
+    ear_triangulation<point_type>::run(rings, &triangles);
+    if (triangles.empty()) {
+      continue;
+    }
+    // the holes lie inside the outer boundary, it bounds the region.
+    rect_type region_rect;
+    extents(region_rect, region);
+    index_box bounds(index_point(xl(region_rect), yl(region_rect)),
+                     index_point(xh(region_rect), yh(region_rect)));
+    add_item(bounds, static_cast<GLuint>(fill_vertices.size() / 2),
+             static_cast<GLuint>(triangles.size()),
+             &items, &result->regions);
+    index_point middle;
+    boost::geometry::centroid(bounds, middle);
+    push_vertex(result->shift, middle.get<0>(), middle.get<1>(),
+                &lod_vertices);
+    for (const auto& vertex : triangles) {
+      push_vertex(result->shift, vertex.x(), vertex.y(), &fill_vertices);
+    }
+  }
+  result->regions.index = range_index(items.begin(), items.end());
+}
 
+void GLWidget::draw_fill() {
+  // Draw the material side.
+  glColor3f(0.8f, 0.8f, 0.8f);
+  draw_ranges(&fill_buffer_, GL_TRIANGLES, visible_fill_);
+  // regions below a pixel are a dot each.
+  glPointSize(2);
+  draw_ranges(&lod_buffer_, GL_POINTS, visible_fill_lods_);
+}
 
+void GLWidget::draw_vertices() {
+  // Draw voronoi vertices.
+  if (!voronoi_shown() || !layout_->has_voronoi()) {
+    return;
+  }
   glColor3f(0.0f, 0.0f, 0.0f);
   glPointSize(6);
   glBegin(GL_POINTS);
-  coordinate_type width = xh(brect_) - xl(brect_);
-  double xxhh = xh(brect_);
-  double xxll = xl(brect_);
-  int xN = 100;
-  coordinate_type height = yh(brect_) - yl(brect_);
-  double yyhh = yh(brect_);
-  double yyll = yl(brect_);
-  int yN = 100;
-  for (int i = 0; i < xN; ++i)
-  {
-      for (int j = 0; j < yN; ++j)
-      {
-          double x = xl(brect_) + (width / xN) * i;
-          double y = yl(brect_) + (height / yN) * j;
-          point_type vertex(x, y);
-          for (const auto& polygon : combined_polygon_set_)
-          {
-              if (contains(polygon, vertex))
-              {
-                  vertex = deconvolve(vertex, shift_);
-                  glVertex2f(vertex.x(), vertex.y());
-              }
-          }
-      }
+  const VD& vd_ = layout_->voronoi();
+  for (const_vertex_iterator it = vd_.vertices().begin();
+       it != vd_.vertices().end(); ++it) {
+    if (internal_edges_only_ &&
+        (it->color() == LayoutClassifier::EXTERNAL_COLOR)) {
+      continue;
+    }
+    glVertex2f(static_cast<GLfloat>(it->x() - shift_.x()),
+               static_cast<GLfloat>(it->y() - shift_.y()));
   }
   glEnd();
-
-  // Draw voronoi vertices.
-//  glColor3f(0.0f, 0.0f, 0.0f);
-//  glPointSize(6);
-//  glBegin(GL_POINTS);
-//  for (const_vertex_iterator it = vd_.vertices().begin();
-//       it != vd_.vertices().end(); ++it) {
-//    if (internal_edges_only_ && (it->color() == EXTERNAL_COLOR)) {
-//      continue;
-//    }
-//    point_type vertex(it->x(), it->y());
-//    vertex = deconvolve(vertex, shift_);
-//    glVertex2f(vertex.x(), vertex.y());
-//  }
-//  glEnd();
 }
+
 void GLWidget::draw_edges() {
   // Draw voronoi edges.
-//  glColor3f(0.0f, 0.0f, 0.0f);
-//  glLineWidth(1.7f);
-//  for (const_edge_iterator it = vd_.edges().begin();
-//       it != vd_.edges().end(); ++it) {
-//    if (primary_edges_only_ && !it->is_primary()) {
-//      continue;
-//    }
-//    if (internal_edges_only_ && (it->color() == EXTERNAL_COLOR)) {
-//      continue;
-//    }
-
-//    std::vector<point_type> samples;
-//    if (!it->is_finite()) {
-//      clip_infinite_edge(*it, &samples);
-//    } else {
-//      point_type vertex0(it->vertex0()->x(), it->vertex0()->y());
-//      samples.push_back(vertex0);
-//      point_type vertex1(it->vertex1()->x(), it->vertex1()->y());
-//      samples.push_back(vertex1);
-//      if (it->is_curved()) {
-//        sample_curved_edge(*it, &samples);
-//      }
-//    }
-//    glBegin(GL_LINE_STRIP);
-//    for (std::size_t i = 0; i < samples.size(); ++i) {
-//      point_type vertex = deconvolve(samples[i], shift_);
-//      glVertex2f(vertex.x(), vertex.y());
-//    }
-//    glEnd();
-//  }
+  if (!voronoi_shown() || !layout_->has_voronoi()) {
+    return;
+  }
+  glColor3f(0.0f, 0.0f, 0.0f);
+  glLineWidth(1.7f);
+  const VD& vd_ = layout_->voronoi();
+  for (const_edge_iterator it = vd_.edges().begin();
+       it != vd_.edges().end(); ++it) {
+    if (primary_edges_only_ && !it->is_primary()) {
+      continue;
+    }
+    if (internal_edges_only_ &&
+        (it->color() == LayoutClassifier::EXTERNAL_COLOR)) {
+      continue;
+    }
+
+    std::vector<view_point> samples;
+    if (!it->is_finite()) {
+      clip_infinite_edge(*it, &samples);
+    } else {
+      view_point vertex0(it->vertex0()->x(), it->vertex0()->y());
+      samples.push_back(vertex0);
+      view_point vertex1(it->vertex1()->x(), it->vertex1()->y());
+      samples.push_back(vertex1);
+      if (it->is_curved()) {
+        sample_curved_edge(*it, &samples);
+      }
+    }
+    glBegin(GL_LINE_STRIP);
+    for (std::size_t i = 0; i < samples.size(); ++i) {
+      view_point vertex = samples[i];
+      deconvolve(vertex, shift_);
+      glVertex2f(vertex.x(), vertex.y());
+    }
+    glEnd();
+  }
 }
 
 void GLWidget::clip_infinite_edge(
-    const edge_type& edge, std::vector<point_type>* clipped_edge) {
+    const edge_type& edge, std::vector<view_point>* clipped_edge) {
   const cell_type& cell1 = *edge.cell();
   const cell_type& cell2 = *edge.twin()->cell();
-  point_type origin, direction;
+  view_point origin, direction;
   // Infinite edges could not be created by two segment sites.
   if (cell1.contains_point() && cell2.contains_point()) {
-    point_type p1 = retrieve_point(cell1);
-    point_type p2 = retrieve_point(cell2);
+    view_point p1 = retrieve_point(cell1);
+    view_point p2 = retrieve_point(cell2);
     origin.x((p1.x() + p2.x()) * 0.5);
     origin.y((p1.y() + p2.y()) * 0.5);
     direction.x(p1.y() - p2.y());
@@ -237,9 +355,10 @@ void GLWidget::clip_infinite_edge(
     segment_type segment = cell1.contains_segment() ?
         retrieve_segment(cell1) :
         retrieve_segment(cell2);
-    coordinate_type dx = high(segment).x() - low(segment).x();
-    coordinate_type dy = high(segment).y() - low(segment).y();
-    if ((low(segment) == origin) ^ cell1.contains_point()) {
+    double dx = static_cast<double>(high(segment).x()) - low(segment).x();
+    double dy = static_cast<double>(high(segment).y()) - low(segment).y();
+    view_point start(low(segment).x(), low(segment).y());
+    if ((start == origin) ^ cell1.contains_point()) {
       direction.x(dy);
       direction.y(-dx);
     } else {
@@ -247,58 +366,61 @@ void GLWidget::clip_infinite_edge(
       direction.y(dx);
     }
   }
-  coordinate_type side = xh(brect_) - xl(brect_);
-  coordinate_type koef =
+  double side = xh(brect_) - xl(brect_);
+  double koef =
       side / (std::max)(fabs(direction.x()), fabs(direction.y()));
   if (edge.vertex0() == NULL) {
-    clipped_edge->push_back(point_type(
+    clipped_edge->push_back(view_point(
         origin.x() - direction.x() * koef,
         origin.y() - direction.y() * koef));
   } else {
     clipped_edge->push_back(
-        point_type(edge.vertex0()->x(), edge.vertex0()->y()));
+        view_point(edge.vertex0()->x(), edge.vertex0()->y()));
   }
   if (edge.vertex1() == NULL) {
-    clipped_edge->push_back(point_type(
+    clipped_edge->push_back(view_point(
         origin.x() + direction.x() * koef,
         origin.y() + direction.y() * koef));
   } else {
     clipped_edge->push_back(
-        point_type(edge.vertex1()->x(), edge.vertex1()->y()));
+        view_point(edge.vertex1()->x(), edge.vertex1()->y()));
   }
 }
 
 void GLWidget::sample_curved_edge(
     const edge_type& edge,
-    std::vector<point_type>* sampled_edge) {
-  coordinate_type max_dist = 1E-3 * (xh(brect_) - xl(brect_));
-  point_type point = edge.cell()->contains_point() ?
+    std::vector<view_point>* sampled_edge) {
+  double max_dist = 1E-3 * (xh(brect_) - xl(brect_));
+  view_point point = edge.cell()->contains_point() ?
       retrieve_point(*edge.cell()) :
       retrieve_point(*edge.twin()->cell());
   segment_type segment = edge.cell()->contains_point() ?
       retrieve_segment(*edge.twin()->cell()) :
       retrieve_segment(*edge.cell());
-  voronoi_visual_utils<coordinate_type>::discretize(
+  voronoi_visual_utils<double>::discretize(
       point, segment, max_dist, sampled_edge);
 }
 
-point_type GLWidget::retrieve_point(const cell_type& cell) {
+GLWidget::view_point GLWidget::retrieve_point(const cell_type& cell) {
+  const std::vector<point_type>& points = layout_->point_data();
+  const std::vector<segment_type>& segments = layout_->segment_data();
   source_index_type index = cell.source_index();
   source_category_type category = cell.source_category();
+  point_type point;
   if (category == SOURCE_CATEGORY_SINGLE_POINT) {
-    return point_data_[index];
-  }
-  index -= point_data_.size();
-  if (category == SOURCE_CATEGORY_SEGMENT_START_POINT) {
-    return low(segment_data_[index]);
+    point = points[index];
+  } else if (category == SOURCE_CATEGORY_SEGMENT_START_POINT) {
+    point = low(segments[index - points.size()]);
   } else {
-    return high(segment_data_[index]);
+    point = high(segments[index - points.size()]);
   }
+  return view_point(point.x(), point.y());
 }
 
 segment_type GLWidget::retrieve_segment(const cell_type& cell) {
-  source_index_type index = cell.source_index() - point_data_.size();
-  return segment_data_[index];
+  source_index_type index =
+      cell.source_index() - layout_->point_data().size();
+  return layout_->segment_data()[index];
 }
 
 
@@ -311,148 +433,225 @@ void GLWidget::initializeGL() {
 }
 
 void GLWidget::paintGL() {
+  trace_scope trace("paint");
+  QElapsedTimer frame_timer;
+  frame_timer.start();
+  ++num_frames_;
   qglClearColor(QColor::fromRgb(255, 255, 255));
   glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-  draw_points();
-  draw_segments();
-  draw_vertices();
-  draw_edges();
-}
+  // the buffers and the projection are relative to shift_.
+  if (brect_initialized_) {
+    update_view_port();
+    collect_visible();
+    glMatrixMode(GL_MODELVIEW);
+    glLoadIdentity();
+
+    draw_fill();
+    draw_points();
+    draw_segments();
+    draw_vertices();
+    draw_edges();
+    Tracer::count("visible_segment_ranges", visible_segments_.size());
+    Tracer::count("visible_fill_ranges", visible_fill_.size());
+  }
 
-void GLWidget::resizeGL(int width, int height) {
-  int side = qMin(width, height);
-  glViewport((width - side) / 2, (height - side) / 2, side, side);
+  if (show_frame_time_) {
+    glFinish();
+    double ms = frame_timer.nsecsElapsed() * 1e-6;
+    glColor3f(0.0f, 0.0f, 0.0f);
+    renderText(10, 20,
+               tr("frame %1: %2 ms").arg(num_frames_).arg(ms, 0, 'f', 2));
+  }
+  // without glFinish() only the time to issue the frame.
+  Tracer::count("frame_ms", frame_timer.nsecsElapsed() * 1e-6);
+  if (show_trace_) {
+    draw_trace();
+  }
 }
 
-void GLWidget::timerEvent(QTimerEvent* e) {
-  update();
+void GLWidget::draw_trace() {
+  std::vector<Tracer::value> spans;
+  std::vector<Tracer::value> counters;
+  Tracer::latest(&spans, &counters);
+  glColor3f(0.0f, 0.0f, 0.0f);
+  int y = show_frame_time_ ? 40 : 20;
+  for (const auto& span : spans) {
+    renderText(10, y, tr("%1: %2 ms").arg(QString::fromLatin1(span.name))
+                                     .arg(span.value, 0, 'f', 2));
+    y += 16;
+  }
+  for (const auto& counter : counters) {
+    renderText(10, y, tr("%1: %2").arg(QString::fromLatin1(counter.name))
+                                  .arg(counter.value, 0, 'f', 0));
+    y += 16;
+  }
 }
 
+void GLWidget::resizeGL(int width, int height) {
+  viewport_side_ = (std::max)(qMin(width, height), 1);
+  viewport_x_ = (width - viewport_side_) / 2;
+  viewport_y_ = (height - viewport_side_) / 2;
+  glViewport(viewport_x_, viewport_y_, viewport_side_, viewport_side_);
+}
 
+void GLWidget::mousePressEvent(QMouseEvent* event) {
+  drag_origin_ = event->pos();
+}
 
-void GLWidget::build(const QString& file_path) {
-  // Clear all containers.
-  clear();
+void GLWidget::mouseMoveEvent(QMouseEvent* event) {
+  if (!(event->buttons() & Qt::LeftButton) || !brect_initialized_) {
+    return;
+  }
+  view_point from = to_layout(drag_origin_);
+  view_point to = to_layout(event->pos());
+  drag_origin_ = event->pos();
+  boost::polygon::move(view_rect_, HORIZONTAL, from.x() - to.x());
+  boost::polygon::move(view_rect_, VERTICAL, from.y() - to.y());
+  update();
+}
 
-  // Read data.
-  read_data(file_path);
+void GLWidget::mouseDoubleClickEvent(QMouseEvent* /* event */) {
+  view_rect_ = brect_;
+  update();
+}
 
-  // No data, don't proceed.
+void GLWidget::wheelEvent(QWheelEvent* event) {
   if (!brect_initialized_) {
     return;
   }
+  // 1.25 per notch, between the whole layout and a millionth of it.
+  double full = xh(brect_) - xl(brect_);
+  double width = xh(view_rect_) - xl(view_rect_);
+  double scale = std::pow(1.25, -event->angleDelta().y() / 120.0);
+  scale = (std::min)((std::max)(scale, full * 1e-6 / width), full / width);
+  // the point under the cursor stays put.
+  view_point anchor = to_layout(event->pos());
+  view_rect_ = view_rect(
+      anchor.x() + (xl(view_rect_) - anchor.x()) * scale,
+      anchor.y() + (yl(view_rect_) - anchor.y()) * scale,
+      anchor.x() + (xh(view_rect_) - anchor.x()) * scale,
+      anchor.y() + (yh(view_rect_) - anchor.y()) * scale);
+  event->accept();
+  update();
+}
 
-  // Construct bounding rectangle.
-  construct_brect();
 
-  // Construct voronoi diagram.
-  construct_voronoi(
-      point_data_.begin(), point_data_.end(),
-      segment_data_.begin(), segment_data_.end(),
-      &vd_);
 
-  // Color exterior edges.
-  for (const_edge_iterator it = vd_.edges().begin();
-       it != vd_.edges().end(); ++it) {
-    if (!it->is_finite()) {
-      color_exterior(&(*it));
+GLWidget::build_result GLWidget::run_build(
+    const QString& file_path, bool with_voronoi,
+    std::shared_ptr<std::atomic<bool> > cancel,
+    std::shared_ptr<LayoutClassifier> layout) {
+  trace_scope trace("run_build");
+  build_result result;
+  result.file_path = file_path;
+  result.layout = layout ? layout : std::make_shared<LayoutClassifier>();
+  result.layout->clear();
+  // a single large layout is split over all cores.
+  result.layout->set_threads(0);
+
+  // Read data.
+  std::string error;
+  {
+    trace_scope read_trace("read");
+    if (!result.layout->read_data(file_path.toLocal8Bit().constData(),
+                                  &error)) {
+      result.error = QString::fromStdString(error);
     }
   }
 
-  // build disjoint polygon sets
-  int pre = 0;
-  for (const auto& i : disjoint_idx_)
-  {
-      std::vector<point_type> pts;
-      poly_type polygon;
-      for (int j = pre; j <= i; ++j)
-      {
-          pts.push_back(segment_data_.at(j).low());
-      }
-      pre = i + 1;
-      set_points(polygon, pts.begin(), pts.end());
-      polygon_data_.push_back(polygon);
+  // No data, don't proceed.
+  if (result.layout->empty()) {
+    return result;
+  }
+
+  // Construct bounding rectangle.
+  construct_brect(*result.layout, &result.brect, &result.shift);
+
+  // Construct the voronoi diagram if it is shown, classify the material
+  // side.
+  if ((with_voronoi && !result.layout->build_voronoi(cancel.get())) ||
+      !result.layout->build(cancel.get())) {
+    result.cancelled = true;
+    return result;
   }
 
+  // Triangulate the interior fill, lay out the vertices and index them
+  // here, finish_build only uploads them.
+  collect_vertices(&result);
+  triangulate_fill(&result);
+  return result;
+}
 
-  // build the matrix to depict the relationship between each disjoint polygon
-  int rows = polygon_data_.size();
-  int columns = polygon_data_.size();
-  int* joint_matrix = new int[rows * columns];
-  for (int i = 0; i < rows; i++)
-  {
-      int* row = &joint_matrix[i * columns];
-
-      for (int j = 0; j < columns; j++)
-      {
-          int* e_ij = &row[j];
-          int* col = &joint_matrix[j * rows];
-          int* e_ji = &col[i];
-          if (i == j)
-          {
-              (*e_ij) = 0;
-              continue;
-          }
-          // is j-th polygon inside current i-th polygon?
-          // if yes, e_ij = 1, e_ji = -1, otherwise, 0
-          // we only need to see if one point from polygon(j) is inside polygon(i) or not
-          // this is because we are assuming they are disjoint polygons which do not intersect
-          if ((*e_ij) == -1)
-          {
-              continue;
-          }
-          bool inside = contains(polygon_data_.at(i), polygon_data_.at(j).coords_.at(0));
-          (*e_ij) = inside ? 1 : 0;
-          (*e_ji) = inside ? -1 : 0;
-      }
+void GLWidget::build(const QString& file_path) {
+  if (cancel_build_) {
+    cancel_build_->store(true);
   }
+  cancel_build_ = std::make_shared<std::atomic<bool> >(false);
+  // setFuture() stops watching the previous build, its result is dropped.
+  build_watcher_.setFuture(QtConcurrent::run(
+      &GLWidget::run_build, file_path, voronoi_shown(), cancel_build_,
+      std::move(spare_layout_)));
+}
 
-  // alwasy reserve memory if size is known. This can avoid deallocate and allocate memory inside std::vector to improve performance
-  ordered_pairs_.resize(rows);
-  // now we fill in ordered_pairs
-  int polygon_idx = 0;
-  for (auto& pair : ordered_pairs_)
-  {
-      pair.first = polygon_idx++; // first = index of polygon_data_
-      int* row = &joint_matrix[pair.first * columns];
-      int num = 0;
-      int sign = 1;
-      for (int j = 0; j < columns; j++)
-      {
-          int* e_ij = &row[j];
-          num += ((*e_ij) == -1) ? 0 : (*e_ij);
-          sign *= ((*e_ij) == 0) ? 1 : (*e_ij);
-      }
-      pair.second.first = sign; // indicates whether the polygon is inner contour or outer contour, 1=out, -1=in
-      pair.second.second = num; // number of polygons encapsulated
-  }
-  // up to this point ordered_pairs should be initialized with correct values, but not sorted
-  // now we need to sort it based on the number of polygons encapsulated
-  std::sort(ordered_pairs_.begin(), ordered_pairs_.end(),
-      [](std::pair<int, std::pair<int ,int>>& a, std::pair<int, std::pair<int ,int>>& b) { return a.second.second > b.second.second;});
-  // perform boolean operations to generate the final combined polygon set
-  for (const auto& pair : ordered_pairs_)
-  {
-      if (pair.second.first == 1)
-      {
-          combined_polygon_set_ += polygon_data_.at(pair.first);
-      }
-      else
-      {
-          combined_polygon_set_ -= polygon_data_.at(pair.first);
-      }
+void GLWidget::finish_build() {
+  build_result result = build_watcher_.result();
+  if (result.cancelled) {
+    return;
+  }
+  if (!result.error.isEmpty()) {
+    QMessageBox::warning(this, tr("Voronoi Visualizer"), result.error);
   }
 
-  delete [] joint_matrix;
-  // Update view port.
-  update_view_port();
+  // Swap in the new geometry as a whole.
+  spare_layout_ = std::move(layout_);
+  layout_ = result.layout;
+  brect_initialized_ = !layout_->empty();
+  brect_ = result.brect;
+  shift_ = result.shift;
+  trace_scope trace("upload");
+  makeCurrent();
+  upload(result.point_vertices, &point_buffer_);
+  upload(result.segment_vertices, &segment_buffer_);
+  upload(result.lod_vertices, &lod_buffer_);
+  upload(result.fill_vertices, &fill_buffer_);
+  points_ = std::move(result.points);
+  contours_ = std::move(result.contours);
+  regions_ = std::move(result.regions);
+
+  // A new layout is shown whole, a rebuild for the diagram keeps the view.
+  if (result.file_path != file_path_ || !brect_initialized_) {
+    view_rect_ = brect_;
+  }
+  file_path_ = result.file_path;
+  update();
+  emit built(result.file_path);
 }
 
 void GLWidget::show_primary_edges_only() {
   primary_edges_only_ ^= true;
+  update_voronoi();
 }
 
 void GLWidget::show_internal_edges_only() {
   internal_edges_only_ ^= true;
+  update_voronoi();
+}
+
+void GLWidget::update_voronoi() {
+  // the shown layout was built without its diagram, build it again with.
+  if (voronoi_shown() && brect_initialized_ && !layout_->has_voronoi()) {
+    build(file_path_);
+  }
+  update();
+}
+
+void GLWidget::show_frame_time() {
+  show_frame_time_ ^= true;
+  update();
+}
+
+void GLWidget::show_trace() {
+  show_trace_ ^= true;
+  update();
 }
@@ -12,110 +12,260 @@
 #include <QLabel>
 #include <QPushButton>
 #include <QApplication>
+#include <QElapsedTimer>
+#include <QFutureWatcher>
+#include <QGLBuffer>
+#include <QtConcurrent/QtConcurrentRun>
+
+#include <atomic>
+#include <memory>
+
+#include <boost/geometry.hpp>
+#include <boost/geometry/index/rtree.hpp>
 
-#include <boost/polygon/polygon.hpp>
-#include <boost/polygon/voronoi.hpp>
-using namespace boost::polygon;
-using namespace boost::polygon::operators;
 #include "voronoi_visual_utils.hpp"
+#include "ear_triangulation.hpp"
+#include "LayoutClassifier.h"
+#include "Tracer.h"
 
 #pragma comment(lib, "opengl32.lib")
 
-typedef double coordinate_type;
-typedef point_data<coordinate_type> point_type;
-typedef segment_data<coordinate_type> segment_type;
-typedef rectangle_data<coordinate_type> rect_type;
-typedef polygon_data<coordinate_type> poly_type;
-typedef voronoi_builder<int> VB;
-typedef voronoi_diagram<coordinate_type> VD;
-typedef VD::cell_type cell_type;
-typedef VD::cell_type::source_index_type source_index_type;
-typedef VD::cell_type::source_category_type source_category_type;
-typedef VD::edge_type edge_type;
-typedef VD::cell_container_type cell_container_type;
-typedef VD::cell_container_type vertex_container_type;
-typedef VD::edge_container_type edge_container_type;
-typedef VD::const_cell_iterator const_cell_iterator;
-typedef VD::const_vertex_iterator const_vertex_iterator;
-typedef VD::const_edge_iterator const_edge_iterator;
-
 class GLWidget : public QGLWidget {
   Q_OBJECT
 
  public:
   explicit GLWidget(QMainWindow* parent = NULL) :
       QGLWidget(QGLFormat(QGL::SampleBuffers), parent),
+      brect_initialized_(false),
       primary_edges_only_(false),
-      internal_edges_only_(false) {
-    startTimer(40);
+      internal_edges_only_(false),
+      show_frame_time_(false),
+      show_trace_(false),
+      num_frames_(0),
+      viewport_x_(0),
+      viewport_y_(0),
+      viewport_side_(1),
+      layout_(std::make_shared<LayoutClassifier>()) {
+    connect(&build_watcher_, SIGNAL(finished()), this, SLOT(finish_build()));
+  }
+
+  ~GLWidget() {
+    if (cancel_build_) {
+      cancel_build_->store(true);
+    }
   }
 
   QSize sizeHint() const {
     return QSize(600, 600);
   }
 
+  // Starts building file_path on a worker thread and returns immediately.
+  // A build still in flight is cancelled. built() is emitted once the new
+  // geometry is shown.
   void build(const QString& file_path);
 
+  // Either of these shows the voronoi diagram, filtered accordingly. The
+  // diagram is only built while shown, turning it on rebuilds the layout.
   void show_primary_edges_only();
   void show_internal_edges_only();
 
+  // Overlays the number and duration of the frames drawn. Waits for the GL
+  // to finish every frame while shown, so the time includes the GPU.
+  void show_frame_time();
+
+  // Overlays the latest span durations and counter values of the Tracer,
+  // which must be enabled separately.
+  void show_trace();
+
  protected:
   void initializeGL();
   void paintGL();
 
   void resizeGL(int width, int height);
 
-  void timerEvent(QTimerEvent* e);
+  // Dragging pans the view, the wheel zooms around the cursor and a double
+  // click fits the whole layout again.
+  void mousePressEvent(QMouseEvent* event);
+  void mouseMoveEvent(QMouseEvent* event);
+  void mouseDoubleClickEvent(QMouseEvent* event);
+  void wheelEvent(QWheelEvent* event);
+
+ signals:
+  void built(const QString& file_path);
+
+ private slots:
+  void finish_build();
+
  private:
+  // the view and the drawn diagram are in floating point, unlike the
+  // layout.
+  typedef point_data<double> view_point;
+  typedef rectangle_data<double> view_rect;
+
+  typedef boost::geometry::model::point<
+      double, 2, boost::geometry::cs::cartesian> index_point;
+  typedef boost::geometry::model::box<index_point> index_box;
+  typedef boost::geometry::index::rtree<
+      std::pair<index_box, std::size_t>,
+      boost::geometry::index::rstar<16> > range_index;
+
+  // Vertices of one contour, point or region in its buffer.
+  struct draw_range {
+    GLuint first;
+    GLuint count;
+  };
+
+  // Items sharing a buffer, with an rtree over their bounds so a frame
+  // only draws the visible ones. Item i below a pixel is drawn as vertex
+  // lod_first + i of the lod buffer instead.
+  struct culling_index {
+    culling_index() : lod_first(0) {}
 
-  static const std::size_t EXTERNAL_COLOR = 1;
+    std::vector<draw_range> ranges;
+    GLuint lod_first;
+    range_index index;
+  };
 
-  void clear();
+  // Everything a build computes off the GUI thread.
+  struct build_result {
+    build_result() : cancelled(false) {}
 
-  void read_data(const QString& file_path);
+    QString file_path;
+    QString error;
+    bool cancelled;
+    std::shared_ptr<LayoutClassifier> layout;
+    view_rect brect;
+    view_point shift;
+    std::vector<GLfloat> point_vertices;
+    std::vector<GLfloat> segment_vertices;
+    std::vector<GLfloat> lod_vertices;
+    std::vector<GLfloat> fill_vertices;
+    culling_index points;
+    culling_index contours;
+    culling_index regions;
+  };
 
-  void update_brect(const point_type& point);
+  // Builds into layout, which is cleared first, or a new one if it is
+  // NULL.
+  static build_result run_build(
+      const QString& file_path, bool with_voronoi,
+      std::shared_ptr<std::atomic<bool> > cancel,
+      std::shared_ptr<LayoutClassifier> layout);
 
-  void construct_brect();
+  static void construct_brect(
+      const LayoutClassifier& layout, view_rect* brect, view_point* shift);
 
-  void color_exterior(const VD::edge_type* edge);
+  // Appends (x, y) - shift. Subtracted in double before the conversion, so
+  // layouts far from the origin keep their low bits in the float buffers.
+  static void push_vertex(const view_point& shift, double x, double y,
+                          std::vector<GLfloat>* vertices);
 
+  // x, y pairs of the input points and of the segment endpoints, one item
+  // per point and per contour. A chain of segments not closing a contour
+  // is an item of its own. lod_vertices is started with the center of
+  // every contour.
+  static void collect_vertices(build_result* result);
+
+  // x, y of three vertices per triangle covering the material regions, one
+  // item per region. The center of every region is appended to
+  // lod_vertices.
+  static void triangulate_fill(build_result* result);
+
+  static void add_item(const index_box& bounds, GLuint first, GLuint count,
+                       std::vector<std::pair<index_box, std::size_t> >* items,
+                       culling_index* target);
+
+  // Sorts ranges by their first vertex and joins those that follow each
+  // other in the buffer, as neighbouring items usually do.
+  static void merge_ranges(std::vector<draw_range>* ranges);
+
+  // Need the GL context to be current.
+  void upload(const std::vector<GLfloat>& vertices, QGLBuffer* target);
+  void draw_ranges(QGLBuffer* source, GLenum mode,
+                   const std::vector<draw_range>& ranges);
+
+  bool voronoi_shown() const {
+    return primary_edges_only_ || internal_edges_only_;
+  }
+
+  // Rebuilds the layout if the diagram is shown but was not built.
+  void update_voronoi();
+
+  // Loads the projection of view_rect_.
   void update_view_port();
 
+  // Fills the visible ranges below with the items intersecting
+  // view_rect_. Contours and regions smaller than a pixel only get their
+  // lod vertex.
+  void collect_visible();
+
+  // Layout coordinates under a widget position.
+  view_point to_layout(const QPoint& pos) const;
+
+  void draw_fill();
   void draw_points();
   void draw_segments();
   void draw_vertices();
   void draw_edges();
+  void draw_trace();
   void clip_infinite_edge(
-      const edge_type& edge, std::vector<point_type>* clipped_edge);
+      const edge_type& edge, std::vector<view_point>* clipped_edge);
   void sample_curved_edge(
       const edge_type& edge,
-      std::vector<point_type>* sampled_edge);
+      std::vector<view_point>* sampled_edge);
 
-  point_type retrieve_point(const cell_type& cell);
+  view_point retrieve_point(const cell_type& cell);
 
   segment_type retrieve_segment(const cell_type& cell);
 
-  point_type shift_;
-  std::vector<point_type> point_data_;
-  std::vector<segment_type> segment_data_;
-  std::vector<poly_type> polygon_data_;
-  rect_type brect_;
-  VB vb_;
-  VD vd_;
+  view_point shift_;
+  view_rect brect_;
   bool brect_initialized_;
   bool primary_edges_only_;
   bool internal_edges_only_;
+  bool show_frame_time_;
+  bool show_trace_;
+  // frames drawn so far. the widget only repaints when something changed,
+  // so this stays put while idle.
+  int num_frames_;
+
+  // visible part of the layout, brect_ when the view is reset. the
+  // viewport is the centered square of the widget.
+  view_rect view_rect_;
+  int viewport_x_;
+  int viewport_y_;
+  int viewport_side_;
+  QPoint drag_origin_;
+
+  // the buffers hold layout coordinates minus shift_, the culling indices
+  // layout coordinates. fill_buffer_ holds the triangulated
+  // combined_polygon_set_, lod_buffer_ a single vertex per contour and
+  // per region for those below a pixel.
+  QGLBuffer point_buffer_;
+  QGLBuffer segment_buffer_;
+  QGLBuffer lod_buffer_;
+  QGLBuffer fill_buffer_;
+  culling_index points_;
+  culling_index contours_;
+  culling_index regions_;
 
-  std::vector<int> disjoint_idx_;
-  // this variable stores the final combined polygon sets after boolean operations.
-  // each disjoint region is one element. so final size is number of disjoint region.
-  std::vector<poly_type> combined_polygon_set_;
+  // vertex ranges of the visible items, merged, rebuilt every frame from
+  // the items rather than their vertices.
+  std::vector<draw_range> visible_points_;
+  std::vector<draw_range> visible_segments_;
+  std::vector<draw_range> visible_lods_;
+  std::vector<draw_range> visible_fill_;
+  std::vector<draw_range> visible_fill_lods_;
 
-  // first = index of the polyon in polygon_data_
-  // second.first = -1 or 1 with 1 meaning out and -1 meaning in
-  // second.second = number of polygons encapsulated
-  std::vector<std::pair<int, std::pair<int, int>>> ordered_pairs_;
+  // geometry of the last finished build, replaced as a whole on the GUI
+  // thread when the next one finishes.
+  QString file_path_;
+  std::shared_ptr<LayoutClassifier> layout_;
+  // the layout shown before layout_, handed to the next build so it
+  // reuses its buffers rather than allocating them again.
+  std::shared_ptr<LayoutClassifier> spare_layout_;
+  QFutureWatcher<build_result> build_watcher_;
+  std::shared_ptr<std::atomic<bool> > cancel_build_;
 };
 
 #endif // GLWIDGET_H
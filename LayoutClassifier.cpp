@@ -0,0 +1,1184 @@
+#include "LayoutClassifier.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <limits>
+#include <numeric>
+#include <thread>
+
+#include "LayoutFormat.h"
+#include "Tracer.h"
+#include "exact_predicates.hpp"
+#include "point_in_contour.hpp"
+
+namespace {
+
+// fewest vertices worth a thread of their own in build().
+const std::size_t MIN_GROUP_VERTICES = 1 << 14;
+
+template <typename T>
+std::size_t capacity_bytes(const std::vector<T>& v) {
+  return v.capacity() * sizeof(T);
+}
+
+std::size_t region_bytes(const poly_with_holes_type& region) {
+  std::size_t bytes = capacity_bytes(region.self_.coords_);
+  for (const auto& hole : region.holes_) {
+    // a list node holds two links besides the hole.
+    bytes += sizeof(hole) + 2 * sizeof(void*) + capacity_bytes(hole.coords_);
+  }
+  return bytes;
+}
+
+// polygon_with_holes_data can be neither moved nor swapped, but its members
+// are public.
+void swap_region(poly_with_holes_type* a, poly_with_holes_type* b) {
+  a->self_.coords_.swap(b->self_.coords_);
+  a->holes_.swap(b->holes_);
+}
+
+// Reports a stage of build() to the listener, if any, and to the tracer
+// while in scope.
+class stage_scope {
+ public:
+  stage_scope(LayoutClassifier::stage_listener* listener, const char* name)
+      : listener_(listener), name_(name), trace_(name) {
+    if (listener_ != NULL) {
+      listener_->begin_stage(name_);
+    }
+  }
+  ~stage_scope() {
+    if (listener_ != NULL) {
+      listener_->end_stage(name_);
+    }
+  }
+
+ private:
+  LayoutClassifier::stage_listener* listener_;
+  const char* name_;
+  trace_scope trace_;
+};
+
+}  // namespace
+
+void LayoutClassifier::clear() {
+  brect_initialized_ = false;
+  point_data_.clear();
+  segment_data_.clear();
+  vd_.clear();
+  voronoi_built_ = false;
+
+  contours_.clear();
+  disjoint_idx_.clear();
+  recycle_regions();
+  contour_parent_.clear();
+  contour_depth_.clear();
+  contour_begin_ = 0;
+  built_ = false;
+  contains_calls_ = 0;
+  group_begin_.clear();
+  group_list_.clear();
+  child_begin_.clear();
+  child_list_.clear();
+  region_idx_.clear();
+  region_owner_.clear();
+}
+
+bool LayoutClassifier::read_data(const std::string& file_path,
+                                 std::string* error) {
+  if (!LayoutReader::read(file_path, this, error)) {
+    clear();
+    return false;
+  }
+  return true;
+}
+
+void LayoutClassifier::reserve_points(std::size_t num_points) {
+  point_data_.reserve(num_points);
+}
+
+void LayoutClassifier::reserve_segments(std::size_t num_segments) {
+  segment_data_.reserve(num_segments);
+}
+
+void LayoutClassifier::add_point(int x, int y) {
+  point_type p(x, y);
+  update_brect(p);
+  point_data_.push_back(p);
+  built_ = false;
+}
+
+void LayoutClassifier::add_segment(int x1, int y1, int x2, int y2) {
+  point_type lp(x1, y1);
+  point_type hp(x2, y2);
+  update_brect(lp);
+  update_brect(hp);
+  // a contour is closed by the first segment ending where it started.
+  if (contour_begin_ == segment_data_.size())
+  {
+      contour_first_ = lp;
+  }
+  segment_data_.push_back(segment_type(lp, hp));
+  built_ = false;
+  if (contour_first_ == hp)
+  {
+      disjoint_idx_.emplace_back(segment_data_.size() - 1);
+      contour_begin_ = segment_data_.size();
+  }
+}
+
+void LayoutClassifier::update_brect(const point_type& point) {
+  if (brect_initialized_) {
+    encompass(brect_, point);
+  } else {
+    set_points(brect_, point, point);
+    brect_initialized_ = true;
+  }
+}
+
+void LayoutClassifier::color_exterior(const VD::edge_type* edge) {
+  // a depth-first walk in the order of the former recursion: an uncolored
+  // edge is colored with its twin and, if primary, continues around its
+  // second vertex. the edges around a vertex are walked by one frame of
+  // color_stack_, so the depth is bounded by memory rather than the stack.
+  auto visit = [this](const VD::edge_type* e) {
+    if (e->color() == EXTERNAL_COLOR) {
+      return;
+    }
+    e->color(EXTERNAL_COLOR);
+    e->twin()->color(EXTERNAL_COLOR);
+    const VD::vertex_type* v = e->vertex1();
+    if (v == NULL || !e->is_primary()) {
+      return;
+    }
+    v->color(EXTERNAL_COLOR);
+    color_frame frame = {v->incident_edge(), v->incident_edge()};
+    color_stack_.push_back(frame);
+  };
+  color_stack_.clear();
+  visit(edge);
+  while (!color_stack_.empty()) {
+    color_frame& frame = color_stack_.back();
+    const VD::edge_type* e = frame.next;
+    if (e == NULL) {
+      color_stack_.pop_back();
+      continue;
+    }
+    frame.next = (e->rot_next() == frame.first) ? NULL : e->rot_next();
+    // may grow color_stack_, frame is not used after this.
+    visit(e);
+  }
+}
+
+bool LayoutClassifier::build_voronoi(const std::atomic<bool>* cancel) {
+  auto cancelled = [cancel]() { return cancel != NULL && cancel->load(); };
+  if (voronoi_built_ || !brect_initialized_) {
+    return true;
+  }
+
+  // Construct voronoi diagram.
+  {
+    stage_scope stage(listener_, "construct_voronoi");
+    // like construct_voronoi(), but the builder keeps its site events for
+    // the next diagram.
+    builder_.clear();
+    insert(point_data_.begin(), point_data_.end(), &builder_);
+    insert(segment_data_.begin(), segment_data_.end(), &builder_);
+    builder_.construct(&vd_);
+  }
+  Tracer::count("voronoi_cells", vd_.num_cells());
+  Tracer::count("voronoi_edges", vd_.num_edges());
+  Tracer::count("voronoi_vertices", vd_.num_vertices());
+  if (cancelled()) {
+    vd_.clear();
+    return false;
+  }
+
+  // Color exterior edges.
+  stage_scope stage(listener_, "color_exterior");
+  for (const_edge_iterator it = vd_.edges().begin();
+       it != vd_.edges().end(); ++it) {
+    if (!it->is_finite()) {
+      color_exterior(&(*it));
+    }
+  }
+  voronoi_built_ = true;
+  return true;
+}
+
+bool LayoutClassifier::build(const std::atomic<bool>* cancel) {
+  auto cancelled = [cancel]() { return cancel != NULL && cancel->load(); };
+
+  // No data, don't proceed.
+  built_ = !brect_initialized_;
+  if (!brect_initialized_) {
+    return true;
+  }
+
+  build_contours();
+  if (cancelled()) {
+    return false;
+  }
+
+  // A large layout falling apart into groups is nested group by group on
+  // threads, each group with a diagram of its own for the voronoi engine.
+  // Otherwise the sweep needs no diagram, the voronoi engine reads the
+  // nesting from it.
+  if (plan_groups()) {
+    if (!nest_groups(cancel)) {
+      return false;
+    }
+  } else if (engine_ == VORONOI_NESTING && !build_voronoi(cancel)) {
+    return false;
+  }
+  if (cancelled()) {
+    return false;
+  }
+  combine_polygons();
+  built_ = true;
+  std::size_t bytes = memory_bytes();
+  peak_memory_bytes_ = (std::max)(peak_memory_bytes_, bytes);
+  Tracer::count("memory_bytes", bytes);
+  return true;
+}
+
+std::size_t LayoutClassifier::memory_bytes() const {
+  std::size_t bytes = capacity_bytes(point_data_) +
+                      capacity_bytes(segment_data_) +
+                      capacity_bytes(vd_.cells()) +
+                      capacity_bytes(vd_.edges()) +
+                      capacity_bytes(vd_.vertices()) +
+                      contours_.capacity_bytes() +
+                      capacity_bytes(disjoint_idx_) +
+                      capacity_bytes(contour_parent_) +
+                      capacity_bytes(contour_depth_) +
+                      capacity_bytes(child_begin_) +
+                      capacity_bytes(child_list_) +
+                      capacity_bytes(region_idx_) +
+                      capacity_bytes(region_owner_) +
+                      capacity_bytes(region_points_) +
+                      capacity_bytes(color_stack_) +
+                      sweep_.capacity_bytes() +
+                      capacity_bytes(faces_.face) +
+                      capacity_bytes(faces_.on_input) +
+                      capacity_bytes(faces_.segment_cell) +
+                      capacity_bytes(faces_.inner) +
+                      capacity_bytes(faces_.outer) +
+                      capacity_bytes(faces_.owner) +
+                      capacity_bytes(faces_.bounded) +
+                      capacity_bytes(faces_.pending) +
+                      capacity_bytes(combined_polygon_set_) +
+                      capacity_bytes(spare_regions_) +
+                      capacity_bytes(group_begin_) +
+                      capacity_bytes(group_list_);
+  for (const auto& group : group_layouts_) {
+    bytes += sizeof(*group) + group->memory_bytes();
+  }
+  for (const auto& region : combined_polygon_set_) {
+    bytes += region_bytes(region);
+  }
+  for (const auto& region : spare_regions_) {
+    bytes += region_bytes(region);
+  }
+  return bytes;
+}
+
+void LayoutClassifier::build_contours() {
+  stage_scope stage(listener_, "contours");
+  std::size_t num_vertices =
+      disjoint_idx_.empty() ? 0 : disjoint_idx_.back() + 1;
+  contours_.clear();
+  contours_.reserve(disjoint_idx_.size(), num_vertices);
+  std::size_t pre = 0;
+  for (int last : disjoint_idx_) {
+    for (std::size_t j = pre; j <= static_cast<std::size_t>(last); ++j) {
+      const point_type& p = low(segment_data_[j]);
+      contours_.push_vertex(p.x(), p.y());
+    }
+    contours_.close();
+    pre = last + 1;
+  }
+}
+
+bool LayoutClassifier::plan_groups() {
+  group_begin_.clear();
+  group_list_.clear();
+  unsigned threads =
+      threads_ != 0 ? threads_ : std::thread::hardware_concurrency();
+  const std::size_t num_contours = contours_.size();
+  const std::size_t num_vertices = contours_.num_vertices();
+  threads = static_cast<unsigned>((std::min<std::size_t>)(
+      threads, num_vertices / MIN_GROUP_VERTICES));
+  // a diagram built already gives the nesting faster than a new one per
+  // group.
+  if (threads < 2 || (engine_ == VORONOI_NESTING && voronoi_built_)) {
+    return false;
+  }
+
+  // a contour nested in another has its box inside the box of the other.
+  // the contours sorted by the left of their boxes are therefore cut where
+  // no box so far reaches the next one, into groups of about equal
+  // vertices.
+  group_list_.resize(num_contours);
+  std::iota(group_list_.begin(), group_list_.end(), 0);
+  std::sort(group_list_.begin(), group_list_.end(), [this](int a, int b) {
+    return contours_.bounds(a).xl < contours_.bounds(b).xl;
+  });
+  group_begin_.push_back(0);
+  std::size_t vertices = 0;
+  std::int32_t reach = 0;
+  for (std::size_t k = 0; k < num_contours; ++k) {
+    const contour_arena::box& b = contours_.bounds(group_list_[k]);
+    if (k > 0 && b.xl > reach &&
+        vertices * threads >= num_vertices * group_begin_.size()) {
+      group_begin_.push_back(static_cast<int>(k));
+    }
+    reach = (k == 0 || b.xh > reach) ? b.xh : reach;
+    vertices += contours_.size(group_list_[k]);
+  }
+  group_begin_.push_back(static_cast<int>(num_contours));
+  if (group_begin_.size() < 3) {
+    group_begin_.clear();
+    group_list_.clear();
+    return false;
+  }
+  // the contours of a group keep their order.
+  for (std::size_t g = 0; g + 1 < group_begin_.size(); ++g) {
+    std::sort(group_list_.begin() + group_begin_[g],
+              group_list_.begin() + group_begin_[g + 1]);
+  }
+  return true;
+}
+
+bool LayoutClassifier::nest_groups(const std::atomic<bool>* cancel) {
+  stage_scope stage(listener_, "nesting");
+  const std::size_t num_groups = group_begin_.size() - 1;
+  while (group_layouts_.size() < num_groups) {
+    group_layouts_.push_back(
+        std::unique_ptr<LayoutClassifier>(new LayoutClassifier()));
+  }
+  std::vector<char> built(num_groups, 0);
+  auto build_group = [&](std::size_t g) {
+    LayoutClassifier& group = *group_layouts_[g];
+    group.clear();
+    group.set_nesting_engine(engine_);
+    std::size_t num_segments = 0;
+    for (int k = group_begin_[g]; k < group_begin_[g + 1]; ++k) {
+      num_segments += contours_.size(group_list_[k]);
+    }
+    group.reserve_segments(num_segments);
+    for (int k = group_begin_[g]; k < group_begin_[g + 1]; ++k) {
+      std::size_t first = contours_.begin(group_list_[k]);
+      std::size_t last = first + contours_.size(group_list_[k]);
+      for (std::size_t j = first; j < last; ++j) {
+        const segment_type& s = segment_data_[j];
+        group.add_segment(low(s).x(), low(s).y(), high(s).x(), high(s).y());
+      }
+    }
+    built[g] = group.build(cancel);
+  };
+  std::vector<std::thread> workers;
+  for (std::size_t g = 1; g < num_groups; ++g) {
+    workers.emplace_back(build_group, g);
+  }
+  build_group(0);
+  for (auto& w : workers) {
+    w.join();
+  }
+  if (std::find(built.begin(), built.end(), 0) != built.end()) {
+    return false;
+  }
+
+  // the contours of a group are numbered in the order they were added.
+  contour_parent_.assign(contours_.size(), -1);
+  contour_depth_.assign(contours_.size(), 0);
+  for (std::size_t g = 0; g < num_groups; ++g) {
+    const LayoutClassifier& group = *group_layouts_[g];
+    const int* ids = &group_list_[group_begin_[g]];
+    for (std::size_t i = 0; i < group.contours_.size(); ++i) {
+      int p = group.contour_parent_[i];
+      contour_parent_[ids[i]] = (p == -1) ? -1 : ids[p];
+      contour_depth_[ids[i]] = group.contour_depth_[i];
+    }
+  }
+  return true;
+}
+
+point_type LayoutClassifier::cell_point(const cell_type& cell) const {
+  source_index_type index = cell.source_index();
+  if (cell.source_category() == SOURCE_CATEGORY_SINGLE_POINT) {
+    return point_data_[index];
+  }
+  const segment_type& segment = segment_data_[index - point_data_.size()];
+  return cell.source_category() == SOURCE_CATEGORY_SEGMENT_START_POINT ?
+      low(segment) : high(segment);
+}
+
+bool LayoutClassifier::nest_by_voronoi() {
+  const std::size_t num_contours = disjoint_idx_.size();
+  const std::size_t num_edges = vd_.num_edges();
+  if (num_edges == 0) {
+    return num_contours == 0;
+  }
+  const VD::edge_type* first_edge = &vd_.edges().front();
+  const VD::vertex_type* first_vertex =
+      vd_.num_vertices() == 0 ? NULL : &vd_.vertices().front();
+  auto edge_index = [first_edge](const VD::edge_type* e) {
+    return static_cast<int>(e - first_edge);
+  };
+
+  // edges meet the input only at input points: at a vertex, or inside the
+  // edge where two collinear segments meet or a segment meets its endpoint
+  // at a right angle. faces are therefore unions of edge ends, 2 * i is the
+  // vertex0 end of edge i and 2 * i + 1 its vertex1 end. the extra element
+  // stands for the infinite face.
+  const int infinite = static_cast<int>(2 * num_edges);
+  std::vector<int>& face = faces_.face;
+  face.resize(2 * num_edges + 1);
+  for (std::size_t i = 0; i < face.size(); ++i) {
+    face[i] = static_cast<int>(i);
+  }
+  auto find = [&face](int i) {
+    while (face[i] != i) {
+      face[i] = face[face[i]];
+      i = face[i];
+    }
+    return i;
+  };
+  auto unite = [&face, &find](int i, int j) {
+    i = find(i);
+    j = find(j);
+    if (i != j) {
+      face[(std::max)(i, j)] = (std::min)(i, j);
+    }
+  };
+
+  // the ends at a vertex off the input share its face.
+  std::vector<char>& on_input = faces_.on_input;
+  on_input.assign(vd_.num_vertices(), 0);
+  for (const auto& v : vd_.vertices()) {
+    const VD::edge_type* e = v.incident_edge();
+    bool touches = false;
+    do {
+      const cell_type& cell = *e->cell();
+      if (cell.contains_point()) {
+        point_type p = cell_point(cell);
+        double tolerance = 1e-9 * (1.0 + std::fabs(p.x()) + std::fabs(p.y()));
+        touches = touches || (std::fabs(p.x() - v.x()) <= tolerance &&
+                              std::fabs(p.y() - v.y()) <= tolerance);
+      }
+      e = e->rot_next();
+    } while (e != v.incident_edge());
+    on_input[&v - first_vertex] = touches;
+    if (touches) {
+      continue;
+    }
+    do {
+      unite(2 * edge_index(e), 2 * edge_index(e->rot_next()));
+      e = e->rot_next();
+    } while (e != v.incident_edge());
+  }
+
+  // side of an input point relative to the line through segment.
+  auto point_side = [](const segment_type& segment, const point_type& p) {
+    return cross_sign(
+        static_cast<std::int64_t>(high(segment).x()) - low(segment).x(),
+        static_cast<std::int64_t>(high(segment).y()) - low(segment).y(),
+        static_cast<std::int64_t>(p.x()) - low(segment).x(),
+        static_cast<std::int64_t>(p.y()) - low(segment).y());
+  };
+
+  // side of a vertex of the cell of segment, off the input, relative to
+  // segment. the vertex is within the strip of the segment, so its empty
+  // circle touches the line through the segment and lies on the side of
+  // the vertex: every other site on the circle is on that side too, or on
+  // the line.
+  auto vertex_side = [&](const segment_type& segment,
+                         const VD::vertex_type& v) {
+    double dx = static_cast<double>(high(segment).x()) - low(segment).x();
+    double dy = static_cast<double>(high(segment).y()) - low(segment).y();
+    double ax = v.x() - low(segment).x();
+    double ay = v.y() - low(segment).y();
+    double cross = dx * ay - dy * ax;
+    // Boost.Polygon computes the vertex coordinates to within 64 machine
+    // epsilons of their magnitude, the differences and products here add
+    // three roundings more. 128 epsilons of the terms bound the error of
+    // cross with room to spare. a vertex may be as close as 1 / (2 |dx, dy|)
+    // to the line, far below this bound at large coordinates.
+    double bound = 128 * std::numeric_limits<double>::epsilon() *
+                   (std::fabs(dx) * (std::fabs(ay) + std::fabs(v.y())) +
+                    std::fabs(dy) * (std::fabs(ax) + std::fabs(v.x())));
+    if (std::fabs(cross) > bound) {
+      return (cross > 0) - (cross < 0);
+    }
+    // where several segments meet at an input point the diagram may put a
+    // vertex there without a point cell around it.
+    for (const point_type& p : {low(segment), high(segment)}) {
+      double tolerance = 1e-9 * (1.0 + std::fabs(p.x()) + std::fabs(p.y()));
+      if (std::fabs(p.x() - v.x()) <= tolerance &&
+          std::fabs(p.y() - v.y()) <= tolerance) {
+        return 0;
+      }
+    }
+    // decided exactly by a point site off the line, or a segment site with
+    // both ends on the same side of it, which then touches the circle
+    // strictly on that side.
+    const VD::edge_type* e = v.incident_edge();
+    do {
+      const cell_type& cell = *e->cell();
+      int side = 0;
+      if (cell.contains_point()) {
+        side = point_side(segment, cell_point(cell));
+      } else {
+        const segment_type& other =
+            segment_data_[cell.source_index() - point_data_.size()];
+        int side0 = point_side(segment, low(other));
+        int side1 = point_side(segment, high(other));
+        side = (side0 == side1) ? side0 : 0;
+      }
+      if (side != 0) {
+        return side;
+      }
+      e = e->rot_next();
+    } while (e != v.incident_edge());
+    // only segments crossing or ending on the line are left, the rounded
+    // sign is the best there is.
+    return (cross > 0) - (cross < 0);
+  };
+
+  // side of an edge end relative to the segment of a cell, 0 if the end is
+  // an input point. infinite ends head off like in
+  // GLWidget::clip_infinite_edge.
+  auto end_side = [&](const segment_type& segment, const VD::edge_type* e,
+                      int end) {
+    std::int64_t dx = static_cast<std::int64_t>(high(segment).x()) -
+                      low(segment).x();
+    std::int64_t dy = static_cast<std::int64_t>(high(segment).y()) -
+                      low(segment).y();
+    const VD::vertex_type* v = (end == 0) ? e->vertex0() : e->vertex1();
+    if (v != NULL) {
+      if (on_input[v - first_vertex]) {
+        return 0;
+      }
+      return vertex_side(segment, *v);
+    }
+    const cell_type& cell1 = *e->cell();
+    const cell_type& cell2 = *e->twin()->cell();
+    std::int64_t ux, uy;
+    if (cell1.contains_point() && cell2.contains_point()) {
+      point_type p1 = cell_point(cell1);
+      point_type p2 = cell_point(cell2);
+      ux = static_cast<std::int64_t>(p1.y()) - p2.y();
+      uy = static_cast<std::int64_t>(p2.x()) - p1.x();
+    } else {
+      point_type origin = cell_point(cell1.contains_point() ? cell1 : cell2);
+      const segment_type& other = segment_data_[
+          (cell1.contains_segment() ? cell1 : cell2).source_index() -
+          point_data_.size()];
+      std::int64_t ox = static_cast<std::int64_t>(high(other).x()) -
+                        low(other).x();
+      std::int64_t oy = static_cast<std::int64_t>(high(other).y()) -
+                        low(other).y();
+      bool flip = (low(other) == origin) ^ cell1.contains_point();
+      ux = flip ? oy : -oy;
+      uy = flip ? -ox : ox;
+    }
+    if (end == 0) {
+      ux = -ux;
+      uy = -uy;
+    }
+    return cross_sign(dx, dy, ux, uy);
+  };
+
+  for (const auto& e : vd_.edges()) {
+    int i = edge_index(&e);
+    int t = edge_index(e.twin());
+    unite(2 * i, 2 * t + 1);
+    unite(2 * i + 1, 2 * t);
+    if (e.vertex0() == NULL) {
+      unite(2 * i, infinite);
+    }
+    if (e.vertex1() == NULL) {
+      unite(2 * i + 1, infinite);
+    }
+    // only an edge of a segment cell can cross the input, its ends then
+    // lie on both sides of the segment.
+    const cell_type* cell = e.cell()->contains_segment() ? e.cell() :
+        e.twin()->cell()->contains_segment() ? e.twin()->cell() : NULL;
+    if (cell != NULL) {
+      const segment_type& segment =
+          segment_data_[cell->source_index() - point_data_.size()];
+      if (end_side(segment, &e, 0) * end_side(segment, &e, 1) < 0) {
+        continue;
+      }
+    }
+    unite(2 * i, 2 * i + 1);
+  }
+
+  std::vector<const cell_type*>& segment_cell = faces_.segment_cell;
+  segment_cell.assign(segment_data_.size(), NULL);
+  for (const auto& cell : vd_.cells()) {
+    if (cell.contains_segment() && cell.incident_edge() != NULL) {
+      segment_cell[cell.source_index() - point_data_.size()] = &cell;
+    }
+  }
+
+  // every segment of a contour borders the same face inside and the same
+  // face outside.
+  std::vector<int>& inner = faces_.inner;
+  std::vector<int>& outer = faces_.outer;
+  inner.assign(num_contours, -1);
+  outer.assign(num_contours, -1);
+  auto border = [&unite](int* bordered, int end) {
+    if (*bordered == -1) {
+      *bordered = end;
+    } else {
+      unite(*bordered, end);
+    }
+  };
+  int pre = 0;
+  for (std::size_t c = 0; c < num_contours; ++c) {
+    int last = disjoint_idx_[c];
+    // counter-clockwise contours have their inside on the left.
+    int inside = contours_.orientation(c);
+    for (int j = pre; j <= last && inside != 0; ++j) {
+      const cell_type* cell = segment_cell[j];
+      if (cell == NULL) {
+        continue;
+      }
+      const VD::edge_type* e = cell->incident_edge();
+      do {
+        for (int end = 0; end < 2; ++end) {
+          int side = end_side(segment_data_[j], e, end);
+          if (side != 0) {
+            border(side == inside ? &inner[c] : &outer[c],
+                   2 * edge_index(e) + end);
+          }
+        }
+        e = e->next();
+      } while (e != cell->incident_edge());
+    }
+    pre = last + 1;
+    if (inner[c] == -1 || outer[c] == -1) {
+      return false;
+    }
+  }
+
+  // the faces form a tree with the contours as its links. walk it from the
+  // infinite face, a contour leads from the face around it to the face it
+  // bounds.
+  std::vector<int>& owner = faces_.owner;
+  std::vector<std::pair<int, int> >& bounded = faces_.bounded;
+  owner.assign(face.size(), -1);
+  bounded.clear();
+  for (std::size_t c = 0; c < num_contours; ++c) {
+    inner[c] = find(inner[c]);
+    outer[c] = find(outer[c]);
+    if (owner[inner[c]] != -1 || inner[c] == outer[c]) {
+      return false;
+    }
+    owner[inner[c]] = static_cast<int>(c);
+    bounded.push_back(std::make_pair(outer[c], static_cast<int>(c)));
+  }
+  std::sort(bounded.begin(), bounded.end());
+  contour_parent_.assign(num_contours, -1);
+  contour_depth_.assign(num_contours, -1);
+  std::vector<int>& pending = faces_.pending;
+  pending.assign(1, find(infinite));
+  std::size_t reached = 0;
+  while (!pending.empty()) {
+    int f = pending.back();
+    pending.pop_back();
+    int around = owner[f];
+    for (auto it = std::lower_bound(bounded.begin(), bounded.end(),
+                                    std::make_pair(f, -1));
+         it != bounded.end() && it->first == f; ++it) {
+      int c = it->second;
+      contour_parent_[c] = around;
+      contour_depth_[c] = (around == -1) ? 0 : contour_depth_[around] + 1;
+      pending.push_back(inner[c]);
+      ++reached;
+    }
+  }
+  return reached == num_contours;
+}
+
+void LayoutClassifier::combine_polygons() {
+  // every contour gets its parent and nesting depth from the voronoi faces
+  // if asked to and possible, from a single plane sweep otherwise, unless
+  // nest_groups() did.
+  if (group_begin_.empty()) {
+    stage_scope stage(listener_, "nesting");
+    if (engine_ != VORONOI_NESTING || !nest_by_voronoi()) {
+      sweep_.run(contours_, &contour_parent_, &contour_depth_);
+    }
+  }
+
+  stage_scope stage(listener_, "regions");
+  link_children();
+
+  // contours at even depth are outer boundaries of material, their
+  // children are the holes. no boolean operations are needed since the
+  // contours do not intersect.
+  region_idx_.assign(contours_.size(), -1);
+  region_owner_.clear();
+  for (std::size_t i = 0; i < contours_.size(); ++i)
+  {
+      if (contour_depth_[i] % 2 == 0)
+      {
+          region_idx_[i] = region_owner_.size();
+          region_owner_.push_back(i);
+      }
+  }
+  // the regions take the storage of those of earlier builds.
+  recycle_regions();
+  combined_polygon_set_.resize(region_owner_.size());
+  if (spare_regions_.size() < combined_polygon_set_.size()) {
+    spare_regions_.resize(combined_polygon_set_.size());
+  }
+  for (std::size_t r = 0; r < combined_polygon_set_.size(); ++r) {
+    swap_region(&combined_polygon_set_[r], &spare_regions_[r]);
+  }
+  if (group_begin_.empty()) {
+    for (std::size_t r = 0; r < region_owner_.size(); ++r)
+    {
+        fill_region(region_owner_[r], &combined_polygon_set_[r]);
+    }
+  } else {
+    // the groups filled the same regions, their holes in the same order.
+    for (std::size_t g = 0; g + 1 < group_begin_.size(); ++g) {
+      LayoutClassifier& group = *group_layouts_[g];
+      const int* ids = &group_list_[group_begin_[g]];
+      for (std::size_t r = 0; r < group.region_owner_.size(); ++r) {
+        int c = ids[group.region_owner_[r]];
+        swap_region(&combined_polygon_set_[region_idx_[c]],
+                    &group.combined_polygon_set_[r]);
+      }
+    }
+  }
+  Tracer::count("num_contours", contours_.size());
+  Tracer::count("num_vertices", contours_.num_vertices());
+  Tracer::count("num_regions", region_owner_.size());
+  Tracer::count("num_holes", contours_.size() - region_owner_.size());
+}
+
+void LayoutClassifier::link_children() {
+  // a counting sort of the contours by parent, stable so children stay in
+  // contour order.
+  const std::size_t num_contours = contours_.size();
+  child_begin_.assign(num_contours + 3, 0);
+  for (std::size_t i = 0; i < num_contours; ++i) {
+    ++child_begin_[contour_parent_[i] + 3];
+  }
+  for (std::size_t k = 1; k < child_begin_.size(); ++k) {
+    child_begin_[k] += child_begin_[k - 1];
+  }
+  child_list_.resize(num_contours);
+  for (std::size_t i = 0; i < num_contours; ++i) {
+    child_list_[child_begin_[contour_parent_[i] + 2]++] = i;
+  }
+}
+
+void LayoutClassifier::fill_region(std::size_t c,
+                                   poly_with_holes_type* region) {
+  // outer boundaries are stored counter-clockwise and holes clockwise.
+  auto fill = [this](std::size_t i, bool outer) {
+    const std::int32_t* xs = contours_.xs(i);
+    const std::int32_t* ys = contours_.ys(i);
+    std::size_t n = contours_.size(i);
+    region_points_.clear();
+    for (std::size_t j = 0; j < n; ++j) {
+      region_points_.push_back(point_type(xs[j], ys[j]));
+    }
+    if ((contours_.orientation(i) > 0) != outer) {
+      std::reverse(region_points_.begin(), region_points_.end());
+    }
+  };
+  fill(c, true);
+  region->set(region_points_.begin(), region_points_.end());
+  // set_holes() would rebuild the list, resizing it keeps the storage of
+  // the holes the region had.
+  region->holes_.resize(child_begin_[c + 2] - child_begin_[c + 1]);
+  int k = child_begin_[c + 1];
+  for (auto& hole : region->holes_) {
+    fill(child_list_[k++], false);
+    hole.set(region_points_.begin(), region_points_.end());
+  }
+}
+
+void LayoutClassifier::recycle_regions() {
+  // every region goes to the place it was taken from, unless the spare
+  // there holds more.
+  if (spare_regions_.size() < combined_polygon_set_.size()) {
+    spare_regions_.resize(combined_polygon_set_.size());
+  }
+  for (std::size_t r = 0; r < combined_polygon_set_.size(); ++r) {
+    poly_with_holes_type& region = combined_polygon_set_[r];
+    poly_with_holes_type& spare = spare_regions_[r];
+    if (region.self_.coords_.capacity() > spare.self_.coords_.capacity()) {
+      swap_region(&region, &spare);
+    }
+  }
+  combined_polygon_set_.clear();
+}
+
+void LayoutClassifier::remove_region(std::size_t c) {
+  int r = region_idx_[c];
+  swap_region(&combined_polygon_set_[r], &combined_polygon_set_.back());
+  combined_polygon_set_.pop_back();
+  region_owner_[r] = region_owner_.back();
+  region_owner_.pop_back();
+  if (r < static_cast<int>(region_owner_.size())) {
+    region_idx_[region_owner_[r]] = r;
+  }
+  region_idx_[c] = -1;
+}
+
+bool LayoutClassifier::contains(std::size_t outer, std::size_t inner) const {
+  ++contains_calls_;
+  const contour_arena::box& o = contours_.bounds(outer);
+  const contour_arena::box& b = contours_.bounds(inner);
+  if (b.xl < o.xl || b.yl < o.yl || b.xh > o.xh || b.yh > o.yh) {
+    return false;
+  }
+  // contours may touch, the first vertex of inner off outer decides. inner
+  // is taken as outside if all of its vertices are on outer.
+  const std::int32_t* xs = contours_.xs(inner);
+  const std::int32_t* ys = contours_.ys(inner);
+  for (std::size_t j = 0; j < contours_.size(inner); ++j) {
+    int side = point_in_contour::locate(contours_.xs(outer),
+                                        contours_.ys(outer),
+                                        contours_.size(outer), xs[j], ys[j]);
+    if (side != 0) {
+      return side > 0;
+    }
+  }
+  return false;
+}
+
+int LayoutClassifier::find_parent(std::size_t c) const {
+  // the contours containing c are nested, so the innermost is the deepest.
+  // the bounding boxes rule out most of them before any vertex is located.
+  int parent = -1;
+  for (std::size_t i = 0; i < contours_.size(); ++i) {
+    if (i != c &&
+        (parent == -1 || contour_depth_[i] > contour_depth_[parent]) &&
+        contains(i, c)) {
+      parent = static_cast<int>(i);
+    }
+  }
+  return parent;
+}
+
+void LayoutClassifier::detach_children(std::size_t c,
+                                       std::vector<int>* moved) {
+  int parent = contour_parent_[c];
+  for (int k = child_begin_[c + 1]; k < child_begin_[c + 2]; ++k) {
+    contour_parent_[child_list_[k]] = parent;
+    moved->push_back(child_list_[k]);
+  }
+}
+
+void LayoutClassifier::adopt_children(std::size_t c,
+                                      std::vector<int>* moved) {
+  // a contour inside c but deeper than its siblings would be inside one of
+  // them, which is then inside c or contains it.
+  int parent = contour_parent_[c];
+  for (int k = child_begin_[parent + 1]; k < child_begin_[parent + 2]; ++k) {
+    int sibling = child_list_[k];
+    if (sibling != static_cast<int>(c) && contains(c, sibling)) {
+      contour_parent_[sibling] = c;
+      moved->push_back(sibling);
+    }
+  }
+}
+
+void LayoutClassifier::update_nesting(const std::vector<int>& moved,
+                                      const std::vector<int>& touched) {
+  link_children();
+  std::vector<int> changed(touched);
+  std::vector<int> pending;
+  for (int m : moved) {
+    pending.push_back(m);
+    while (!pending.empty()) {
+      int c = pending.back();
+      pending.pop_back();
+      int p = contour_parent_[c];
+      contour_depth_[c] = (p == -1) ? 0 : contour_depth_[p] + 1;
+      changed.push_back(c);
+      if (p != -1) {
+        changed.push_back(p);
+      }
+      for (int k = child_begin_[c + 1]; k < child_begin_[c + 2]; ++k) {
+        pending.push_back(child_list_[k]);
+      }
+    }
+  }
+  std::sort(changed.begin(), changed.end());
+  changed.erase(std::unique(changed.begin(), changed.end()), changed.end());
+
+  // a contour now at odd depth bounds no region, one at even depth bounds
+  // one with its current children as holes.
+  for (int c : changed) {
+    if (contour_depth_[c] % 2 == 1 && region_idx_[c] != -1) {
+      remove_region(c);
+    }
+  }
+  for (int c : changed) {
+    if (contour_depth_[c] % 2 == 1) {
+      continue;
+    }
+    if (region_idx_[c] == -1) {
+      region_idx_[c] = region_owner_.size();
+      region_owner_.push_back(c);
+      combined_polygon_set_.push_back(poly_with_holes_type());
+    }
+    fill_region(c, &combined_polygon_set_[region_idx_[c]]);
+  }
+}
+
+void LayoutClassifier::drop_voronoi() {
+  vd_.clear();
+  voronoi_built_ = false;
+}
+
+bool LayoutClassifier::add_contour(const std::vector<point_type>& vertices) {
+  if (!built_ || vertices.size() < 3) {
+    return false;
+  }
+  trace_scope trace("add_contour");
+  drop_voronoi();
+  // the segments go right after those of the last contour, before any
+  // chain that does not close.
+  const std::size_t n = vertices.size();
+  const std::size_t first =
+      disjoint_idx_.empty() ? 0 : disjoint_idx_.back() + 1;
+  segment_data_.insert(segment_data_.begin() + first, n, segment_type());
+  for (std::size_t j = 0; j < n; ++j) {
+    const point_type& p = vertices[j];
+    segment_data_[first + j] = segment_type(p, vertices[(j + 1) % n]);
+    update_brect(p);
+    contours_.push_vertex(p.x(), p.y());
+  }
+  contours_.close();
+  disjoint_idx_.push_back(first + n - 1);
+  contour_begin_ += n;
+
+  const std::size_t c = contours_.size() - 1;
+  contour_parent_.push_back(-1);
+  contour_depth_.push_back(0);
+  region_idx_.push_back(-1);
+  contour_parent_[c] = find_parent(c);
+  std::vector<int> moved(1, c);
+  adopt_children(c, &moved);
+  update_nesting(moved, std::vector<int>());
+  Tracer::count("contains_calls", contains_calls_);
+  return true;
+}
+
+bool LayoutClassifier::remove_contour(std::size_t c) {
+  if (!built_ || c >= contours_.size()) {
+    return false;
+  }
+  trace_scope trace("remove_contour");
+  drop_voronoi();
+  std::vector<int> moved;
+  detach_children(c, &moved);
+  if (region_idx_[c] != -1) {
+    remove_region(c);
+  }
+  int parent = contour_parent_[c];
+
+  const std::size_t first = contours_.begin(c);
+  const std::size_t n = contours_.size(c);
+  segment_data_.erase(segment_data_.begin() + first,
+                      segment_data_.begin() + first + n);
+  contours_.erase(c);
+  disjoint_idx_.erase(disjoint_idx_.begin() + c);
+  for (std::size_t j = c; j < disjoint_idx_.size(); ++j) {
+    disjoint_idx_[j] -= n;
+  }
+  contour_begin_ -= n;
+  contour_parent_.erase(contour_parent_.begin() + c);
+  contour_depth_.erase(contour_depth_.begin() + c);
+  region_idx_.erase(region_idx_.begin() + c);
+  // contours after c move down by one.
+  auto renumber = [c](int* i) {
+    if (*i > static_cast<int>(c)) {
+      --*i;
+    }
+  };
+  for (int& p : contour_parent_) {
+    renumber(&p);
+  }
+  for (int& owner : region_owner_) {
+    renumber(&owner);
+  }
+  for (int& m : moved) {
+    renumber(&m);
+  }
+  renumber(&parent);
+
+  std::vector<int> touched;
+  if (parent != -1) {
+    touched.push_back(parent);
+  }
+  update_nesting(moved, touched);
+  return true;
+}
+
+bool LayoutClassifier::move_contour(std::size_t c, coordinate_type dx,
+                                    coordinate_type dy) {
+  if (!built_ || c >= contours_.size()) {
+    return false;
+  }
+  // the box bounds every vertex, so a box that stays in range keeps them
+  // all in range.
+  const contour_arena::box& b = contours_.bounds(c);
+  const std::int64_t lowest = (std::numeric_limits<coordinate_type>::min)();
+  const std::int64_t highest = (std::numeric_limits<coordinate_type>::max)();
+  if (static_cast<std::int64_t>(b.xl) + dx < lowest ||
+      static_cast<std::int64_t>(b.xh) + dx > highest ||
+      static_cast<std::int64_t>(b.yl) + dy < lowest ||
+      static_cast<std::int64_t>(b.yh) + dy > highest) {
+    return false;
+  }
+  trace_scope trace("move_contour");
+  drop_voronoi();
+  // take c out of the nesting, shift it and put it back in.
+  std::vector<int> moved;
+  detach_children(c, &moved);
+  update_nesting(moved, std::vector<int>(1, c));
+
+  contours_.translate(c, dx, dy);
+  const std::size_t first = contours_.begin(c);
+  const std::size_t n = contours_.size(c);
+  const std::int32_t* xs = contours_.xs(c);
+  const std::int32_t* ys = contours_.ys(c);
+  for (std::size_t j = 0; j < n; ++j) {
+    std::size_t k = (j + 1 == n) ? 0 : j + 1;
+    point_type p(xs[j], ys[j]);
+    segment_data_[first + j] = segment_type(p, point_type(xs[k], ys[k]));
+    update_brect(p);
+  }
+
+  std::vector<int> touched;
+  if (contour_parent_[c] != -1) {
+    touched.push_back(contour_parent_[c]);
+  }
+  contour_parent_[c] = find_parent(c);
+  moved.assign(1, c);
+  adopt_children(c, &moved);
+  update_nesting(moved, touched);
+  Tracer::count("contains_calls", contains_calls_);
+  return true;
+}
+
+bool LayoutClassifier::write_material(const std::string& file_path,
+                                      std::string* error) const {
+  std::ofstream out_stream(file_path.c_str());
+  if (!out_stream) {
+    if (error) {
+      *error = "Unable to open file " + file_path;
+    }
+    return false;
+  }
+  std::size_t num_segments = 0;
+  for (const auto& region : combined_polygon_set_)
+  {
+      num_segments += region.size();
+      for (auto it = region.begin_holes(); it != region.end_holes(); ++it)
+      {
+          num_segments += it->size();
+      }
+  }
+  // one contour per line chain. combine_polygons() already oriented them,
+  // so the output reads back as the same material.
+  auto write_contour = [&out_stream](const poly_type& contour) {
+    for (auto it = contour.begin(); it != contour.end(); ++it) {
+      auto next = std::next(it);
+      const point_type& hp = (next == contour.end()) ? *contour.begin() : *next;
+      out_stream << it->x() << " " << it->y() << " "
+                 << hp.x() << " " << hp.y() << "\n";
+    }
+  };
+  out_stream << 0 << "\n" << num_segments << "\n";
+  for (const auto& region : combined_polygon_set_)
+  {
+      poly_type outer;
+      outer.set(region.begin(), region.end());
+      write_contour(outer);
+      for (auto it = region.begin_holes(); it != region.end_holes(); ++it)
+      {
+          write_contour(*it);
+      }
+  }
+  return static_cast<bool>(out_stream);
+}
+
+bool LayoutClassifier::write_binary(const std::string& file_path,
+                                    std::string* error) const {
+  // split the segments into chains, a new one starts wherever a segment
+  // does not continue from the end of the previous one.
+  std::vector<std::uint32_t> offsets;
+  std::vector<std::int32_t> vertices;
+  vertices.reserve(2 * (segment_data_.size() + 1));
+  for (std::size_t i = 0; i < segment_data_.size(); ++i) {
+    const segment_type& segment = segment_data_[i];
+    if (i == 0 || low(segment) != high(segment_data_[i - 1])) {
+      offsets.push_back(static_cast<std::uint32_t>(vertices.size() / 2));
+      vertices.push_back(static_cast<std::int32_t>(x(low(segment))));
+      vertices.push_back(static_cast<std::int32_t>(y(low(segment))));
+    }
+    vertices.push_back(static_cast<std::int32_t>(x(high(segment))));
+    vertices.push_back(static_cast<std::int32_t>(y(high(segment))));
+  }
+  offsets.push_back(static_cast<std::uint32_t>(vertices.size() / 2));
+
+  layout_header header;
+  std::memcpy(header.magic, LAYOUT_MAGIC, sizeof(LAYOUT_MAGIC));
+  header.version = LAYOUT_VERSION;
+  header.num_points = static_cast<std::uint32_t>(point_data_.size());
+  header.num_chains = static_cast<std::uint32_t>(offsets.size() - 1);
+  header.num_vertices = static_cast<std::uint32_t>(vertices.size() / 2);
+  header.reserved = 0;
+  header.bbox[0] = header.bbox[1] = header.bbox[2] = header.bbox[3] = 0;
+  if (brect_initialized_) {
+    header.bbox[0] = static_cast<std::int32_t>(xl(brect_));
+    header.bbox[1] = static_cast<std::int32_t>(yl(brect_));
+    header.bbox[2] = static_cast<std::int32_t>(xh(brect_));
+    header.bbox[3] = static_cast<std::int32_t>(yh(brect_));
+  }
+  std::vector<std::int32_t> points;
+  points.reserve(2 * point_data_.size());
+  for (const auto& p : point_data_) {
+    points.push_back(static_cast<std::int32_t>(p.x()));
+    points.push_back(static_cast<std::int32_t>(p.y()));
+  }
+
+  std::ofstream out_stream(file_path.c_str(), std::ios::binary);
+  if (!out_stream) {
+    if (error) {
+      *error = "Unable to open file " + file_path;
+    }
+    return false;
+  }
+  out_stream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  out_stream.write(reinterpret_cast<const char*>(points.data()),
+                   points.size() * sizeof(std::int32_t));
+  out_stream.write(reinterpret_cast<const char*>(offsets.data()),
+                   offsets.size() * sizeof(std::uint32_t));
+  out_stream.write(reinterpret_cast<const char*>(vertices.data()),
+                   vertices.size() * sizeof(std::int32_t));
+  if (!out_stream) {
+    if (error) {
+      *error = "Unable to write file " + file_path;
+    }
+    return false;
+  }
+  return true;
+}
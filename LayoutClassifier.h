@@ -0,0 +1,321 @@
+#ifndef LAYOUTCLASSIFIER_H
+#define LAYOUTCLASSIFIER_H
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <boost/polygon/polygon.hpp>
+#include <boost/polygon/voronoi.hpp>
+using namespace boost::polygon;
+using namespace boost::polygon::operators;
+#include "LayoutReader.h"
+#include "contour_arena.hpp"
+#include "nesting_sweep.hpp"
+
+// Layout coordinates are read as int and stay integral, so the layout is
+// compact and every predicate on it is exact. Only the voronoi diagram
+// computes in double.
+typedef int coordinate_type;
+typedef point_data<coordinate_type> point_type;
+typedef segment_data<coordinate_type> segment_type;
+typedef rectangle_data<coordinate_type> rect_type;
+typedef polygon_data<coordinate_type> poly_type;
+typedef polygon_with_holes_data<coordinate_type> poly_with_holes_type;
+typedef voronoi_builder<int> VB;
+typedef voronoi_diagram<double> VD;
+typedef VD::cell_type cell_type;
+typedef VD::cell_type::source_index_type source_index_type;
+typedef VD::cell_type::source_category_type source_category_type;
+typedef VD::edge_type edge_type;
+typedef VD::cell_container_type cell_container_type;
+typedef VD::cell_container_type vertex_container_type;
+typedef VD::edge_container_type edge_container_type;
+typedef VD::const_cell_iterator const_cell_iterator;
+typedef VD::const_vertex_iterator const_vertex_iterator;
+typedef VD::const_edge_iterator const_edge_iterator;
+
+// Reads a layout of points and closed contours and decides which side of
+// every contour is material. Has no Qt or OpenGL dependency, so it is shared
+// by the visualizer and the batch tool.
+class LayoutClassifier : public LayoutSink {
+ public:
+  static const std::size_t EXTERNAL_COLOR = 1;
+
+  // How build() finds the contours containing each contour.
+  enum nesting_engine {
+    // plane sweep over the segments, see nesting_sweep.hpp.
+    SWEEP_NESTING,
+    // faces of the voronoi diagram, which build() then constructs too.
+    VORONOI_NESTING
+  };
+
+  // Told when each stage of build() and build_voronoi() starts and ends,
+  // for profiling. Stages do not nest: "construct_voronoi" and
+  // "color_exterior" build the diagram, "contours" fills contours(),
+  // "nesting" finds the parent of every contour and "regions" assembles
+  // combined_polygon_set().
+  class stage_listener {
+   public:
+    virtual ~stage_listener() {}
+    virtual void begin_stage(const char* name) = 0;
+    virtual void end_stage(const char* name) = 0;
+  };
+
+  LayoutClassifier()
+      : brect_initialized_(false),
+        voronoi_built_(false),
+        contour_begin_(0),
+        engine_(SWEEP_NESTING),
+        built_(false),
+        listener_(NULL),
+        contains_calls_(0),
+        peak_memory_bytes_(0),
+        threads_(1) {}
+
+  // Both engines give the same regions. Kept across clear().
+  void set_nesting_engine(nesting_engine engine) { engine_ = engine; }
+  nesting_engine engine() const { return engine_; }
+
+  // Threads build() may use, 0 for one per core. A layout whose contours
+  // fall apart along x into groups that nest nothing in each other is then
+  // split into as many groups of about equal vertices, which are nested on
+  // threads of their own, each with a voronoi diagram of its own for the
+  // voronoi engine, and merged. voronoi() is then left empty. Layouts of
+  // fewer than about 16k vertices per thread are built on one thread, as
+  // are layouts whose diagram is built already with the voronoi engine.
+  // The regions are the same either way. Kept across clear().
+  void set_threads(unsigned threads) { threads_ = threads; }
+  unsigned threads() const { return threads_; }
+  // Groups the last build() was split into, 0 if it ran on one thread.
+  std::size_t num_groups() const {
+    return group_begin_.empty() ? 0 : group_begin_.size() - 1;
+  }
+
+  // Not owned, NULL to stop listening. Kept across clear().
+  void set_stage_listener(stage_listener* listener) { listener_ = listener; }
+
+  // Empties the layout. The capacity of its buffers, the voronoi diagram
+  // and the regions is kept, so the next layout of similar size is read
+  // and built with few allocations.
+  void clear();
+
+  // Reads a text or binary layout through LayoutReader. Returns false and
+  // sets error if the file cannot be read; the layout is then left empty.
+  bool read_data(const std::string& file_path, std::string* error);
+
+  // LayoutSink, appends geometry to the layout. A segment ending where the
+  // current contour started closes that contour.
+  void reserve_points(std::size_t num_points) override;
+  void reserve_segments(std::size_t num_segments) override;
+  void add_point(int x, int y) override;
+  void add_segment(int x1, int y1, int x2, int y2) override;
+
+  // Constructs the combined material polygons, and the voronoi diagram
+  // only if the nesting engine needs it. If cancel is given it is polled
+  // between the stages, build() then returns false as soon as it is set and
+  // leaves the results incomplete.
+  bool build(const std::atomic<bool>* cancel = NULL);
+
+  // Constructs the voronoi diagram and colors its exterior, for callers
+  // showing it. Does nothing if the diagram is built already. Returns false
+  // if cancelled, the diagram is then left empty.
+  bool build_voronoi(const std::atomic<bool>* cancel = NULL);
+  bool has_voronoi() const { return voronoi_built_; }
+
+  // Edits of a built layout, whose contours must still not intersect each
+  // other afterwards. Only the nesting below the contours whose parent
+  // changes and the regions bounded by those contours or their parents are
+  // updated, the rest of the layout is left as it is. Nesting is decided by
+  // point_in_contour whatever the engine. The voronoi diagram is dropped
+  // and the bounding box only grows. Each returns false and changes nothing
+  // if the layout was not built since it was last read or appended to.
+  //
+  // Appends a closed contour through vertices, which must be at least
+  // three. It is then the last of contours().
+  bool add_contour(const std::vector<point_type>& vertices);
+  // Removes contour c. The contours after it move down by one.
+  bool remove_contour(std::size_t c);
+  // Shifts contour c by (dx, dy). Returns false and changes nothing if a
+  // vertex would leave the range of coordinate_type.
+  bool move_contour(std::size_t c, coordinate_type dx, coordinate_type dy);
+  // Number of contour containment tests run by the edits since the layout
+  // was cleared.
+  std::size_t contains_calls() const { return contains_calls_; }
+
+  // Writes combined_polygon_set() in the input text format: every outer
+  // boundary counter-clockwise followed by its holes clockwise.
+  bool write_material(const std::string& file_path, std::string* error) const;
+
+  // Writes the input points and segments in the binary format.
+  bool write_binary(const std::string& file_path, std::string* error) const;
+
+  bool empty() const { return !brect_initialized_; }
+
+  const rect_type& brect() const { return brect_; }
+  const std::vector<point_type>& point_data() const { return point_data_; }
+  const std::vector<segment_type>& segment_data() const {
+    return segment_data_;
+  }
+  // closed contours, indexed like contour_end(). a contour has the low
+  // points of its segments, so its vertices are numbered like segment_data().
+  const contour_arena& contours() const { return contours_; }
+  const std::vector<poly_with_holes_type>& combined_polygon_set() const {
+    return combined_polygon_set_;
+  }
+  // index of the last segment of every closed contour, in segment_data()
+  // order. segments after the last one belong to no closed contour.
+  const std::vector<int>& contour_end() const { return disjoint_idx_; }
+  const std::vector<int>& contour_depth() const { return contour_depth_; }
+  const VD& voronoi() const { return vd_; }
+
+  // Heap bytes held by the layout, its results and the buffers kept for
+  // the next build, summed over the capacities of the containers. The
+  // transient queues of the voronoi builder are not counted.
+  std::size_t memory_bytes() const;
+  // The most memory_bytes() at the end of a build() since construction,
+  // kept across clear().
+  std::size_t peak_memory_bytes() const { return peak_memory_bytes_; }
+
+ private:
+  void update_brect(const point_type& point);
+
+  // Colors everything reachable from edge through primary edges with
+  // EXTERNAL_COLOR.
+  void color_exterior(const VD::edge_type* edge);
+
+  // Fills contours_ from the closed contours of segment_data_.
+  void build_contours();
+
+  // Splits the contours into groups for threads_ and returns true, or
+  // returns false if the layout is built on one thread.
+  bool plan_groups();
+  // Builds every group in a layout of its own on a thread of its own and
+  // takes the nesting from them. Returns false if cancelled.
+  bool nest_groups(const std::atomic<bool>* cancel);
+
+  // Fills contour_parent_ and contour_depth_ from vd_. Every face of the
+  // plane cut by the contours is a connected part of the diagram, each
+  // contour separates the face inside it from the face around it, and the
+  // number of contours crossed on the way from the infinite face is the
+  // depth. Returns false, leaving the nesting to nesting_sweep, if the
+  // diagram does not split into faces that way, e.g. for touching contours.
+  bool nest_by_voronoi();
+
+  // Input point a point cell was built from.
+  point_type cell_point(const cell_type& cell) const;
+
+  void combine_polygons();
+  // Moves the regions to spare_regions_ and empties combined_polygon_set_.
+  void recycle_regions();
+
+  // Contour containing c that is innermost, or -1. Considers all contours
+  // but c.
+  int find_parent(std::size_t c) const;
+
+  // True if contour inner lies inside contour outer.
+  bool contains(std::size_t outer, std::size_t inner) const;
+
+  // Makes the children of c children of its parent, or adopts the children
+  // of its parent that c contains, and appends the contours whose parent
+  // changed to moved.
+  void detach_children(std::size_t c, std::vector<int>* moved);
+  void adopt_children(std::size_t c, std::vector<int>* moved);
+
+  // Fills child_begin_ and child_list_ from contour_parent_.
+  void link_children();
+
+  // Recomputes the depth below every contour of moved, whose parents are
+  // up to date, and the regions of the contours it changed, of their
+  // parents and of the contours in touched, whose children changed.
+  void update_nesting(const std::vector<int>& moved,
+                      const std::vector<int>& touched);
+
+  void drop_voronoi();
+
+  // Sets region to contour c, which must be at even depth, with its
+  // children as holes.
+  void fill_region(std::size_t c, poly_with_holes_type* region);
+  void remove_region(std::size_t c);
+
+  std::vector<point_type> point_data_;
+  std::vector<segment_type> segment_data_;
+  contour_arena contours_;
+  rect_type brect_;
+  VD vd_;
+  bool brect_initialized_;
+  bool voronoi_built_;
+
+  std::vector<int> disjoint_idx_;
+  // first segment and start point of the contour being read.
+  std::size_t contour_begin_;
+  point_type contour_first_;
+  // this variable stores the final combined polygon sets.
+  // each disjoint region is one element. so final size is number of disjoint region.
+  std::vector<poly_with_holes_type> combined_polygon_set_;
+
+  // nesting forest over contours_, indexed like contours_.
+  // contour_parent_ is the innermost contour containing it or -1 for roots,
+  // contour_depth_ the number of contours containing it. contours at even
+  // depth bound material, contours at odd depth bound voids.
+  std::vector<int> contour_parent_;
+  std::vector<int> contour_depth_;
+  nesting_engine engine_;
+  // set by build(), cleared when the contours no longer match contours_.
+  bool built_;
+  stage_listener* listener_;
+  mutable std::size_t contains_calls_;
+  std::size_t peak_memory_bytes_;
+  unsigned threads_;
+
+  // contours of group g are group_list_[group_begin_[g],
+  // group_begin_[g + 1]), both empty unless the last build was split.
+  // group_layouts_ are kept across builds like the buffers below.
+  std::vector<int> group_begin_;
+  std::vector<int> group_list_;
+  std::vector<std::unique_ptr<LayoutClassifier> > group_layouts_;
+
+  // kept across builds, so their buffers are only allocated while they
+  // grow.
+  VB builder_;
+  nesting_sweep sweep_;
+  // the storage of the regions of earlier builds, see recycle_regions().
+  std::vector<poly_with_holes_type> spare_regions_;
+  // scratch of nest_by_voronoi().
+  struct face_scratch {
+    std::vector<int> face;
+    std::vector<char> on_input;
+    std::vector<const cell_type*> segment_cell;
+    std::vector<int> inner;
+    std::vector<int> outer;
+    std::vector<int> owner;
+    // (face around, contour) of every contour, sorted.
+    std::vector<std::pair<int, int> > bounded;
+    std::vector<int> pending;
+  };
+  face_scratch faces_;
+
+  // children of contour c are child_list_[child_begin_[c + 1],
+  // child_begin_[c + 2]), roots come first.
+  std::vector<int> child_begin_;
+  std::vector<int> child_list_;
+  // region of combined_polygon_set_ bounded by each contour or -1, and the
+  // contour bounding each region.
+  std::vector<int> region_idx_;
+  std::vector<int> region_owner_;
+  // scratch of fill_region().
+  std::vector<point_type> region_points_;
+
+  // pending walk of color_exterior, one frame per vertex entered. kept
+  // across calls so the walks of a build allocate only while it grows.
+  struct color_frame {
+    const VD::edge_type* first;
+    // next edge around the vertex, NULL once all were visited.
+    const VD::edge_type* next;
+  };
+  std::vector<color_frame> color_stack_;
+};
+
+#endif // LAYOUTCLASSIFIER_H
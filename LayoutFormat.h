@@ -0,0 +1,32 @@
+#ifndef LAYOUTFORMAT_H
+#define LAYOUTFORMAT_H
+
+#include <cstdint>
+
+// Binary layout format, little endian, version 1:
+//
+//   layout_header
+//   int32  points[2 * num_points]          x, y of the single input points
+//   uint32 chain_offsets[num_chains + 1]   first vertex of every chain
+//   int32  vertices[2 * num_vertices]      x, y of the chain vertices
+//
+// A chain is a run of input segments where every segment starts at the end
+// of the previous one, so each vertex is stored once; a closed contour
+// repeats its first vertex at the end. Chains keep the segment order of the
+// text file, so the contours read back exactly as from the text format.
+struct layout_header {
+  char magic[4];
+  std::uint32_t version;
+  std::uint32_t num_points;
+  std::uint32_t num_chains;
+  std::uint32_t num_vertices;
+  std::uint32_t reserved;
+  // xl, yl, xh, yh over all points and vertices, zero for an empty layout.
+  std::int32_t bbox[4];
+};
+
+static const char LAYOUT_MAGIC[4] = { 'M', 'S', 'O', 'P' };
+static const std::uint32_t LAYOUT_VERSION = 1;
+static const char* const LAYOUT_EXTENSION = ".msop";
+
+#endif // LAYOUTFORMAT_H
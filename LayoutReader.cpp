@@ -0,0 +1,217 @@
+#include "LayoutReader.h"
+
+#include <algorithm>
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+#include <sstream>
+
+#include "LayoutFormat.h"
+#include "MappedFile.h"
+
+namespace {
+
+// Scans the whitespace separated integers of the input format straight out
+// of the mapped file, counting lines for error messages.
+class text_scanner {
+ public:
+  text_scanner(const char* begin, const char* end)
+      : p_(begin), end_(end), line_(1), token_line_(1) {}
+
+  // Skips whitespace and tells whether anything is left.
+  bool at_end() {
+    skip_space();
+    return p_ == end_;
+  }
+
+  template <typename T>
+  bool next(T* value, std::string* message) {
+    skip_space();
+    if (p_ == end_) {
+      // the record was cut short, report the line of its last token
+      // rather than the one past the final newline.
+      line_ = token_line_;
+      *message = "unexpected end of file";
+      return false;
+    }
+    token_line_ = line_;
+    std::from_chars_result result = std::from_chars(p_, end_, *value);
+    if (result.ec == std::errc::result_out_of_range) {
+      *message = "integer out of range";
+      return false;
+    }
+    if (result.ec != std::errc() ||
+        (result.ptr != end_ && !is_space(*result.ptr))) {
+      *message = "expected an integer";
+      return false;
+    }
+    p_ = result.ptr;
+    return true;
+  }
+
+  int line() const { return line_; }
+
+ private:
+  static bool is_space(char c) {
+    return c == ' ' || c == '\n' || c == '\r' || c == '\t' ||
+           c == '\v' || c == '\f';
+  }
+
+  void skip_space() {
+    while (p_ != end_ && is_space(*p_)) {
+      if (*p_ == '\n') {
+        ++line_;
+      }
+      ++p_;
+    }
+  }
+
+  const char* p_;
+  const char* end_;
+  int line_;
+  // line of the last token read.
+  int token_line_;
+};
+
+}  // namespace
+
+bool LayoutReader::read(const std::string& file_path, LayoutSink* sink,
+                        std::string* error) {
+  MappedFile file;
+  if (!file.open(file_path, error)) {
+    return false;
+  }
+  if (file.size() >= sizeof(LAYOUT_MAGIC) &&
+      std::memcmp(file.data(), LAYOUT_MAGIC, sizeof(LAYOUT_MAGIC)) == 0) {
+    return read_binary(file_path, file.data(), file.size(), sink, error);
+  }
+  return read_text(file_path, file.data(), file.size(), sink, error);
+}
+
+bool LayoutReader::read_text(const std::string& file_path, const char* data,
+                             std::size_t size, LayoutSink* sink,
+                             std::string* error) {
+  text_scanner in_stream(data, data + size);
+  std::string message;
+  auto fail = [&]() {
+    if (error) {
+      std::ostringstream out;
+      out << file_path << ":" << in_stream.line() << ": " << message;
+      *error = out.str();
+    }
+    return false;
+  };
+
+  // An empty file is an empty layout.
+  if (in_stream.at_end()) {
+    return true;
+  }
+  std::size_t num_points = 0, num_segments = 0;
+  int x1 = 0, y1 = 0, x2 = 0, y2 = 0;
+  if (!in_stream.next(&num_points, &message)) {
+    return fail();
+  }
+  // every point takes at least 4 bytes, never reserve more than the file
+  // could hold even if the declared count is bogus.
+  sink->reserve_points((std::min)(num_points, size / 4));
+  for (std::size_t i = 0; i < num_points; ++i) {
+    // like the stream reader before, records missing at the end of the
+    // file are dropped, only a partial record is an error.
+    if (in_stream.at_end()) {
+      break;
+    }
+    if (!in_stream.next(&x1, &message) || !in_stream.next(&y1, &message)) {
+      return fail();
+    }
+    sink->add_point(x1, y1);
+  }
+  // the segment count may be left out if there are no segments.
+  if (!in_stream.at_end() && !in_stream.next(&num_segments, &message)) {
+    return fail();
+  }
+  sink->reserve_segments((std::min)(num_segments, size / 8));
+  for (std::size_t i = 0; i < num_segments; ++i) {
+    if (in_stream.at_end()) {
+      break;
+    }
+    if (!in_stream.next(&x1, &message) || !in_stream.next(&y1, &message) ||
+        !in_stream.next(&x2, &message) || !in_stream.next(&y2, &message)) {
+      return fail();
+    }
+    sink->add_segment(x1, y1, x2, y2);
+  }
+  return true;
+}
+
+bool LayoutReader::read_binary(const std::string& file_path, const char* data,
+                               std::size_t size, LayoutSink* sink,
+                               std::string* error) {
+  auto fail = [&](const char* message) {
+    if (error) {
+      *error = file_path + ": " + message;
+    }
+    return false;
+  };
+  layout_header header;
+  if (size < sizeof(header)) {
+    return fail("truncated header");
+  }
+  std::memcpy(&header, data, sizeof(header));
+  if (header.version != LAYOUT_VERSION) {
+    return fail("unsupported version");
+  }
+  // all sizes in 64 bits, the counts come straight from the file.
+  std::uint64_t points_bytes = 8ull * header.num_points;
+  std::uint64_t offsets_bytes = 4ull * (header.num_chains + 1ull);
+  std::uint64_t vertices_bytes = 8ull * header.num_vertices;
+  if (sizeof(header) + points_bytes + offsets_bytes + vertices_bytes != size) {
+    return fail("size does not match the header");
+  }
+  const char* points = data + sizeof(header);
+  const char* offsets = points + points_bytes;
+  const char* vertices = offsets + offsets_bytes;
+  auto int_at = [](const char* p, std::size_t i) {
+    std::int32_t value;
+    std::memcpy(&value, p + 4 * i, sizeof(value));
+    return value;
+  };
+  auto offset_at = [](const char* p, std::size_t i) {
+    std::uint32_t value;
+    std::memcpy(&value, p + 4 * i, sizeof(value));
+    return value;
+  };
+
+  // validate the chain offsets before sizing anything from them. Compared
+  // in 64 bits, begin + 2 must not wrap around for a corrupt begin.
+  if (offset_at(offsets, 0) != 0 ||
+      offset_at(offsets, header.num_chains) != header.num_vertices) {
+    return fail("corrupt chain offsets");
+  }
+  for (std::uint32_t c = 0; c < header.num_chains; ++c) {
+    std::uint64_t begin = offset_at(offsets, c);
+    std::uint64_t end = offset_at(offsets, c + 1);
+    if (end > header.num_vertices || end < begin + 2) {
+      return fail("corrupt chain offsets");
+    }
+  }
+
+  sink->reserve_points(header.num_points);
+  for (std::uint32_t i = 0; i < header.num_points; ++i) {
+    sink->add_point(int_at(points, 2 * i), int_at(points, 2 * i + 1));
+  }
+  sink->reserve_segments(header.num_vertices - header.num_chains);
+  for (std::uint32_t c = 0; c < header.num_chains; ++c) {
+    std::uint32_t begin = offset_at(offsets, c);
+    std::uint32_t end = offset_at(offsets, c + 1);
+    std::int32_t x1 = int_at(vertices, 2 * begin);
+    std::int32_t y1 = int_at(vertices, 2 * begin + 1);
+    for (std::uint32_t v = begin + 1; v < end; ++v) {
+      std::int32_t x2 = int_at(vertices, 2 * v);
+      std::int32_t y2 = int_at(vertices, 2 * v + 1);
+      sink->add_segment(x1, y1, x2, y2);
+      x1 = x2;
+      y1 = y2;
+    }
+  }
+  return true;
+}
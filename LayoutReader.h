@@ -0,0 +1,44 @@
+#ifndef LAYOUTREADER_H
+#define LAYOUTREADER_H
+
+#include <cstddef>
+#include <string>
+
+// Receives the points and segments of a layout in file order.
+class LayoutSink {
+ public:
+  virtual ~LayoutSink() {}
+
+  // Called before the points and before the segments with the counts
+  // declared by the file, already capped by what the file could hold.
+  virtual void reserve_points(std::size_t /* num_points */) {}
+  virtual void reserve_segments(std::size_t /* num_segments */) {}
+
+  virtual void add_point(int x, int y) = 0;
+
+  virtual void add_segment(int x1, int y1, int x2, int y2) = 0;
+};
+
+// Parses the point/segment text format, or the binary format of
+// LayoutFormat.h if the file starts with its magic, from a memory mapping
+// of the file and hands the geometry to a sink as it is read. Nothing is
+// buffered, so a sink that does not keep the geometry needs no memory for
+// it.
+class LayoutReader {
+ public:
+  // Returns false and sets error, with the line number for malformed text,
+  // if the file cannot be read. The sink may have received part of the
+  // geometry by then.
+  static bool read(const std::string& file_path, LayoutSink* sink,
+                   std::string* error);
+
+ private:
+  static bool read_text(const std::string& file_path, const char* data,
+                        std::size_t size, LayoutSink* sink,
+                        std::string* error);
+  static bool read_binary(const std::string& file_path, const char* data,
+                          std::size_t size, LayoutSink* sink,
+                          std::string* error);
+};
+
+#endif // LAYOUTREADER_H
@@ -0,0 +1,124 @@
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+
+MappedFile::MappedFile()
+    : data_(NULL), size_(0), file_(INVALID_HANDLE_VALUE), mapping_(NULL) {}
+
+bool MappedFile::open(const std::string& file_path, std::string* error) {
+  close();
+  HANDLE file = CreateFileA(file_path.c_str(), GENERIC_READ, FILE_SHARE_READ,
+                            NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+  if (file == INVALID_HANDLE_VALUE) {
+    if (error) {
+      *error = "Unable to open file " + file_path;
+    }
+    return false;
+  }
+  file_ = file;
+  LARGE_INTEGER size;
+  if (!GetFileSizeEx(file, &size)) {
+    if (error) {
+      *error = "Unable to read file " + file_path;
+    }
+    close();
+    return false;
+  }
+  size_ = static_cast<std::size_t>(size.QuadPart);
+  if (size_ == 0) {
+    return true;
+  }
+  mapping_ = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+  if (mapping_ != NULL) {
+    data_ = static_cast<const char*>(
+        MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0));
+  }
+  if (data_ == NULL) {
+    if (error) {
+      *error = "Unable to map file " + file_path;
+    }
+    close();
+    return false;
+  }
+  return true;
+}
+
+void MappedFile::close() {
+  if (data_ != NULL) {
+    UnmapViewOfFile(data_);
+  }
+  if (mapping_ != NULL) {
+    CloseHandle(mapping_);
+  }
+  if (file_ != INVALID_HANDLE_VALUE) {
+    CloseHandle(file_);
+  }
+  data_ = NULL;
+  size_ = 0;
+  mapping_ = NULL;
+  file_ = INVALID_HANDLE_VALUE;
+}
+
+#else
+
+MappedFile::MappedFile() : data_(NULL), size_(0) {}
+
+bool MappedFile::open(const std::string& file_path, std::string* error) {
+  close();
+  int fd = ::open(file_path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    if (error) {
+      *error = "Unable to open file " + file_path;
+    }
+    return false;
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    if (error) {
+      *error = "Unable to read file " + file_path;
+    }
+    ::close(fd);
+    return false;
+  }
+  size_ = static_cast<std::size_t>(st.st_size);
+  if (size_ != 0) {
+    void* data = mmap(NULL, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (data == MAP_FAILED) {
+      if (error) {
+        *error = "Unable to map file " + file_path;
+      }
+      size_ = 0;
+      ::close(fd);
+      return false;
+    }
+    // the file is scanned once from front to back.
+    madvise(data, size_, MADV_SEQUENTIAL);
+    data_ = static_cast<const char*>(data);
+  }
+  // the mapping stays valid after the descriptor is closed.
+  ::close(fd);
+  return true;
+}
+
+void MappedFile::close() {
+  if (data_ != NULL) {
+    munmap(const_cast<char*>(data_), size_);
+  }
+  data_ = NULL;
+  size_ = 0;
+}
+
+#endif
+
+MappedFile::~MappedFile() {
+  close();
+}
@@ -0,0 +1,34 @@
+#ifndef MAPPEDFILE_H
+#define MAPPEDFILE_H
+
+#include <cstddef>
+#include <string>
+
+// Read-only memory mapping of a whole file.
+class MappedFile {
+ public:
+  MappedFile();
+  ~MappedFile();
+
+  // Maps file_path, unmapping any previous file. Returns false and sets
+  // error if the file cannot be opened or mapped.
+  bool open(const std::string& file_path, std::string* error);
+
+  void close();
+
+  const char* data() const { return data_; }
+  std::size_t size() const { return size_; }
+
+ private:
+  MappedFile(const MappedFile&);
+  MappedFile& operator=(const MappedFile&);
+
+  const char* data_;
+  std::size_t size_;
+#ifdef _WIN32
+  void* file_;
+  void* mapping_;
+#endif
+};
+
+#endif // MAPPEDFILE_H
@@ -0,0 +1,332 @@
+#include "StreamingClassifier.h"
+
+#include <algorithm>
+#include <climits>
+#include <cstdio>
+
+#include <boost/polygon/polygon.hpp>
+
+#include "Tracer.h"
+#include "exact_predicates.hpp"
+#include "point_in_contour.hpp"
+
+namespace {
+
+// room for the segment count, written once all regions are out.
+const int COUNT_WIDTH = 20;
+
+}  // namespace
+
+StreamingClassifier::StreamingClassifier() : verify_(false) {
+  reset();
+}
+
+StreamingClassifier::~StreamingClassifier() {
+  reset();
+}
+
+void StreamingClassifier::reset() {
+  for (const auto& value : index_) {
+    delete value.second;
+  }
+  index_.clear();
+  roots_.clear();
+  current_x_.clear();
+  current_y_.clear();
+  first_x_ = first_y_ = 0;
+  sorted_ = true;
+  front_ = LLONG_MIN;
+  open_xh_ = LLONG_MAX;
+  written_ = false;
+  held_contours_ = 0;
+  held_vertices_ = 0;
+  num_segments_ = 0;
+  stats_ = stream_stats();
+}
+
+bool StreamingClassifier::run(const std::string& input_path,
+                              const std::string& output_path,
+                              std::string* error) {
+  reset();
+  trace_scope trace("stream");
+  out_stream_.open(output_path.c_str());
+  if (!out_stream_) {
+    if (error) {
+      *error = "Unable to open file " + output_path;
+    }
+    return false;
+  }
+  out_stream_ << 0 << "\n" << std::string(COUNT_WIDTH, ' ') << "\n";
+  bool ok = LayoutReader::read(input_path, this, error);
+  if (ok && stats_.late_contours != 0) {
+    if (error) {
+      *error = input_path + ": " + std::to_string(stats_.late_contours) +
+               " contours out of order overlap regions already written";
+    }
+    ok = false;
+  }
+  if (ok) {
+    flush(LLONG_MAX);
+    std::string count = std::to_string(num_segments_);
+    out_stream_.seekp(2);
+    out_stream_.write(count.data(), count.size());
+    if (!out_stream_) {
+      if (error) {
+        *error = "Unable to write file " + output_path;
+      }
+      ok = false;
+    }
+  }
+  out_stream_.close();
+  out_stream_.clear();
+  if (!ok) {
+    // don't leave the regions of a partial read behind.
+    std::remove(output_path.c_str());
+  }
+  Tracer::count("num_contours", stats_.contours);
+  Tracer::count("num_regions", stats_.regions);
+  Tracer::count("contains_calls", stats_.contains_calls);
+  stream_stats stats = stats_;
+  reset();
+  stats_ = stats;
+  return ok;
+}
+
+void StreamingClassifier::add_point(int /* x */, int /* y */) {
+}
+
+void StreamingClassifier::add_segment(int x1, int y1, int x2, int y2) {
+  // a contour is closed by the first segment ending where it started, like
+  // LayoutClassifier::add_segment. an unclosed chain at the end of the file
+  // is dropped.
+  if (current_x_.empty()) {
+    first_x_ = x1;
+    first_y_ = y1;
+  }
+  current_x_.push_back(x1);
+  current_y_.push_back(y1);
+  if (x2 == first_x_ && y2 == first_y_) {
+    close_contour();
+  }
+}
+
+void StreamingClassifier::close_contour() {
+  contour_node* node = new contour_node;
+  // copy rather than move, current_x_ and current_y_ keep their capacity
+  // for the next one.
+  node->xs.assign(current_x_.begin(), current_x_.end());
+  node->ys.assign(current_y_.begin(), current_y_.end());
+  current_x_.clear();
+  current_y_.clear();
+
+  std::size_t n = node->xs.size();
+  node->xl = node->xh = node->xs[0];
+  node->yl = node->yh = node->ys[0];
+  wide_int twice_area;
+  for (std::size_t i = 0; i < n; ++i) {
+    std::int32_t x = node->xs[i], y = node->ys[i];
+    std::size_t j = (i + 1 == n) ? 0 : i + 1;
+    twice_area += cross(x, y, node->xs[j], node->ys[j]);
+    node->xl = (std::min)(node->xl, x);
+    node->xh = (std::max)(node->xh, x);
+    node->yl = (std::min)(node->yl, y);
+    node->yh = (std::max)(node->yh, y);
+  }
+  node->area_sign = twice_area.sign();
+  node->depth = 0;
+  node->parent = NULL;
+  node->slot = 0;
+  ++stats_.contours;
+
+  // the containing contours form a chain, the deepest one is the parent.
+  index_box box = bounds(*node);
+  contour_node* parent = NULL;
+  for (auto it = index_.qbegin(boost::geometry::index::covers(box));
+       it != index_.qend(); ++it) {
+    contour_node* candidate = it->second;
+    if ((parent == NULL || candidate->depth > parent->depth) &&
+        contains(*candidate, *node)) {
+      parent = candidate;
+    }
+  }
+
+  if (parent == NULL) {
+    if (sorted_ && node->xl < front_) {
+      sorted_ = false;
+    }
+    if (sorted_) {
+      front_ = node->xl;
+      if (front_ > open_xh_) {
+        flush(front_);
+      }
+    } else if (written_ &&
+               boost::geometry::intersects(box, written_box_)) {
+      // may contain, or lie inside, a region already written.
+      ++stats_.late_contours;
+    }
+  }
+
+  // contours read before their container become its children.
+  std::vector<contour_node*> adopted;
+  for (auto it = index_.qbegin(boost::geometry::index::covered_by(box));
+       it != index_.qend(); ++it) {
+    contour_node* sibling = it->second;
+    if (sibling->parent == parent && contains(*node, *sibling)) {
+      adopted.push_back(sibling);
+    }
+  }
+  link(node, parent);
+  for (contour_node* child : adopted) {
+    unlink(child);
+    link(child, node);
+  }
+
+  index_.insert(index_value(box, node));
+  ++held_contours_;
+  held_vertices_ += n;
+  stats_.peak_contours = (std::max)(stats_.peak_contours, held_contours_);
+  stats_.peak_vertices = (std::max)(stats_.peak_vertices, held_vertices_);
+}
+
+void StreamingClassifier::link(contour_node* child, contour_node* parent) {
+  child->parent = parent;
+  if (parent == NULL) {
+    child->slot = roots_.size();
+    roots_.push_back(child);
+    open_xh_ = (std::min<std::int64_t>)(open_xh_, child->xh);
+  } else {
+    parent->children.push_back(child);
+  }
+  // depths below an adopted contour grow with it.
+  std::vector<contour_node*> pending(1, child);
+  while (!pending.empty()) {
+    contour_node* c = pending.back();
+    pending.pop_back();
+    c->depth = (c->parent == NULL) ? 0 : c->parent->depth + 1;
+    pending.insert(pending.end(), c->children.begin(), c->children.end());
+  }
+}
+
+void StreamingClassifier::unlink(contour_node* child) {
+  if (child->parent == NULL) {
+    roots_[child->slot] = roots_.back();
+    roots_[child->slot]->slot = child->slot;
+    roots_.pop_back();
+  } else {
+    std::vector<contour_node*>& siblings = child->parent->children;
+    siblings.erase(std::find(siblings.begin(), siblings.end(), child));
+  }
+  child->parent = NULL;
+}
+
+void StreamingClassifier::flush(std::int64_t x) {
+  open_xh_ = LLONG_MAX;
+  for (std::size_t i = 0; i < roots_.size();) {
+    contour_node* root = roots_[i];
+    if (root->xh < x) {
+      if (written_) {
+        boost::geometry::expand(written_box_, bounds(*root));
+      } else {
+        written_box_ = bounds(*root);
+        written_ = true;
+      }
+      unlink(root);
+      write_tree(root);
+    } else {
+      open_xh_ = (std::min<std::int64_t>)(open_xh_, root->xh);
+      ++i;
+    }
+  }
+}
+
+void StreamingClassifier::write_tree(contour_node* root) {
+  // contours at even depth bound material, their children are the holes
+  // and the grandchildren start regions of their own.
+  std::vector<contour_node*> regions(1, root);
+  while (!regions.empty()) {
+    contour_node* region = regions.back();
+    regions.pop_back();
+    write_contour(*region, true);
+    ++stats_.regions;
+    for (contour_node* hole : region->children) {
+      write_contour(*hole, false);
+      regions.insert(regions.end(), hole->children.begin(),
+                     hole->children.end());
+      release(hole);
+    }
+    release(region);
+  }
+}
+
+void StreamingClassifier::write_contour(const contour_node& contour,
+                                        bool outer) {
+  // outer boundaries counter-clockwise and holes clockwise, as in
+  // LayoutClassifier::write_material.
+  std::size_t n = contour.xs.size();
+  bool reverse = (contour.area_sign > 0) != outer;
+  auto vertex = [&](std::size_t i) {
+    return reverse ? n - 1 - i : i;
+  };
+  for (std::size_t i = 0; i < n; ++i) {
+    std::size_t a = vertex(i);
+    std::size_t b = vertex(i + 1 == n ? 0 : i + 1);
+    out_stream_ << contour.xs[a] << " " << contour.ys[a] << " "
+                << contour.xs[b] << " " << contour.ys[b] << "\n";
+  }
+  num_segments_ += n;
+}
+
+void StreamingClassifier::release(contour_node* contour) {
+  index_.remove(index_value(bounds(*contour), contour));
+  --held_contours_;
+  held_vertices_ -= contour->xs.size();
+  delete contour;
+}
+
+StreamingClassifier::index_box StreamingClassifier::bounds(
+    const contour_node& contour) {
+  return index_box(index_point(contour.xl, contour.yl),
+                   index_point(contour.xh, contour.yh));
+}
+
+bool StreamingClassifier::contains(const contour_node& outer,
+                                   const contour_node& inner) {
+  ++stats_.contains_calls;
+  if (inner.xl < outer.xl || inner.xh > outer.xh ||
+      inner.yl < outer.yl || inner.yh > outer.yh) {
+    return false;
+  }
+  // contours may touch, the first vertex off the boundary decides.
+  for (std::size_t i = 0; i < inner.xs.size(); ++i) {
+    int side = locate(outer, inner.xs[i], inner.ys[i]);
+    if (side != 0) {
+      return side > 0;
+    }
+  }
+  return false;
+}
+
+int StreamingClassifier::locate(const contour_node& contour, std::int32_t x,
+                                std::int32_t y) {
+  int side = point_in_contour::locate(contour.xs.data(), contour.ys.data(),
+                                      contour.xs.size(), x, y);
+  if (verify_) {
+    typedef boost::polygon::point_data<std::int32_t> point;
+    std::vector<point> vertices;
+    for (std::size_t i = 0; i < contour.xs.size(); ++i) {
+      vertices.push_back(point(contour.xs[i], contour.ys[i]));
+    }
+    boost::polygon::polygon_data<std::int32_t> polygon(vertices.begin(),
+                                                       vertices.end());
+    bool touching = boost::polygon::contains(polygon, point(x, y), true);
+    bool inside = boost::polygon::contains(polygon, point(x, y), false);
+    int expected = inside ? 1 : touching ? 0 : -1;
+    if (side != expected ||
+        side != point_in_contour::locate_scalar(contour.xs.data(),
+                                                contour.ys.data(),
+                                                contour.xs.size(), x, y)) {
+      ++stats_.verify_mismatches;
+    }
+  }
+  return side;
+}
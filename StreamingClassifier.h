@@ -0,0 +1,150 @@
+#ifndef STREAMINGCLASSIFIER_H
+#define STREAMINGCLASSIFIER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <boost/geometry.hpp>
+#include <boost/geometry/index/rtree.hpp>
+
+#include "LayoutReader.h"
+
+// Classifies a layout while it is read, for files too large to hold with
+// LayoutClassifier. Contours are taken one at a time as LayoutReader
+// delivers them and inserted into a nesting forest of the contours still
+// held, found through an rtree over their bounding boxes; single points are
+// ignored since they never bound material.
+//
+// If top-level contours arrive in order of their leftmost x, each followed
+// by the contours nested in it in any order, a top-level contour ending left
+// of the newest one can gain no more children or parents. Its regions are
+// then written right away and its contours freed, so memory scales with the
+// contours crossing the sweep front rather than with the file.
+//
+// From the first top-level contour out of order on, nothing more is written
+// before the end of the file. Input in any other order is still classified
+// exactly unless a contour out of order overlaps the bounding box of the
+// regions written before it, as it may nest with them. Such contours are
+// counted in late_contours and fail run().
+class StreamingClassifier : public LayoutSink {
+ public:
+  struct stream_stats {
+    std::size_t contours;
+    std::size_t regions;
+    // most contours and vertices held at the same time.
+    std::size_t peak_contours;
+    std::size_t peak_vertices;
+    // contours out of order overlapping the regions already written.
+    std::size_t late_contours;
+    // contour containment tests run while nesting.
+    std::size_t contains_calls;
+    // point locations where the kernel disagreed with its scalar path or
+    // with Boost.Polygon, counted with set_verify() only.
+    std::size_t verify_mismatches;
+  };
+
+  StreamingClassifier();
+  ~StreamingClassifier();
+
+  // Reads input_path and writes its material regions to output_path in the
+  // format of LayoutClassifier::write_material, in the order the regions
+  // are completed. The segment count is only known at the end, it is
+  // written over a line of spaces reserved for it and keeps the spaces
+  // after it. Returns false and sets error if either file fails or
+  // late_contours is not zero, the output is then removed.
+  bool run(const std::string& input_path, const std::string& output_path,
+           std::string* error);
+
+  const stream_stats& statistics() const { return stats_; }
+
+  // Checks every point location of point_in_contour against its scalar
+  // path and boost::polygon::contains. Slow, for testing the kernel.
+  void set_verify(bool verify) { verify_ = verify; }
+
+  // LayoutSink
+  void add_point(int x, int y) override;
+  void add_segment(int x1, int y1, int x2, int y2) override;
+
+ private:
+  struct contour_node {
+    // vertices, the first one is not repeated. kept apart for
+    // point_in_contour.
+    std::vector<std::int32_t> xs;
+    std::vector<std::int32_t> ys;
+    std::int32_t xl, yl, xh, yh;
+    int area_sign;
+    // number of contours containing this one.
+    int depth;
+    contour_node* parent;
+    // owned, freed when the tree is written.
+    std::vector<contour_node*> children;
+    // position in roots_ while parent is NULL.
+    std::size_t slot;
+  };
+
+  typedef boost::geometry::model::point<
+      std::int32_t, 2, boost::geometry::cs::cartesian> index_point;
+  typedef boost::geometry::model::box<index_point> index_box;
+  typedef std::pair<index_box, contour_node*> index_value;
+  typedef boost::geometry::index::rtree<
+      index_value, boost::geometry::index::quadratic<16>> index_type;
+
+  StreamingClassifier(const StreamingClassifier&);
+  StreamingClassifier& operator=(const StreamingClassifier&);
+
+  void reset();
+
+  void close_contour();
+
+  // Makes child a child of parent, or a root if parent is NULL.
+  void link(contour_node* child, contour_node* parent);
+  void unlink(contour_node* child);
+
+  // Writes and frees every top-level contour ending left of x.
+  void flush(std::int64_t x);
+
+  // Writes and frees the regions of a top-level contour and its children.
+  void write_tree(contour_node* root);
+
+  void write_contour(const contour_node& contour, bool outer);
+
+  void release(contour_node* contour);
+
+  static index_box bounds(const contour_node& contour);
+
+  // Tells whether inner lies inside outer, the contours do not cross.
+  bool contains(const contour_node& outer, const contour_node& inner);
+
+  // 1 if (x, y) is inside the contour, 0 on its boundary, -1 outside.
+  int locate(const contour_node& contour, std::int32_t x, std::int32_t y);
+
+  // every contour held, by bounding box.
+  index_type index_;
+  std::vector<contour_node*> roots_;
+  // vertices of the contour being read.
+  std::vector<std::int32_t> current_x_;
+  std::vector<std::int32_t> current_y_;
+  std::int32_t first_x_, first_y_;
+
+  // leftmost x of the newest top-level contour while they arrive in that
+  // order.
+  bool sorted_;
+  std::int64_t front_;
+  // lower bound of the right ends of the top-level contours.
+  std::int64_t open_xh_;
+  // bounding box of the top-level contours written so far.
+  bool written_;
+  index_box written_box_;
+
+  std::size_t held_contours_;
+  std::size_t held_vertices_;
+  std::size_t num_segments_;
+  std::ofstream out_stream_;
+  stream_stats stats_;
+  bool verify_;
+};
+
+#endif // STREAMINGCLASSIFIER_H
@@ -0,0 +1,147 @@
+#include "Tracer.h"
+
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <mutex>
+
+std::atomic<bool> Tracer::enabled_(false);
+
+namespace {
+
+struct event {
+  const char* name;
+  // 'X' for a span, 'C' for a counter value.
+  char phase;
+  int thread;
+  std::int64_t begin;
+  std::int64_t duration;
+  double value;
+};
+
+// a trace left running for hours stops growing here, the latest values go
+// on being updated.
+const std::size_t MAX_EVENTS = 1 << 20;
+
+struct trace_state {
+  trace_state() : dropped(0) {}
+
+  std::mutex mutex;
+  std::vector<event> events;
+  std::size_t dropped;
+  std::vector<Tracer::value> latest_spans;
+  std::vector<Tracer::value> latest_counters;
+};
+
+trace_state& state() {
+  static trace_state instance;
+  return instance;
+}
+
+// small and stable thread ids read better in the trace viewer than hashes.
+int thread_index() {
+  static std::atomic<int> next(1);
+  thread_local int index = next++;
+  return index;
+}
+
+void set_latest(std::vector<Tracer::value>* values, const char* name,
+                double value) {
+  for (auto& v : *values) {
+    if (std::strcmp(v.name, name) == 0) {
+      v.value = value;
+      return;
+    }
+  }
+  Tracer::value v = {name, value};
+  values->push_back(v);
+}
+
+void record(const event& e) {
+  trace_state& s = state();
+  std::lock_guard<std::mutex> lock(s.mutex);
+  if (e.phase == 'X') {
+    set_latest(&s.latest_spans, e.name, e.duration * 1e-3);
+  } else {
+    set_latest(&s.latest_counters, e.name, e.value);
+  }
+  if (s.events.size() < MAX_EVENTS) {
+    s.events.push_back(e);
+  } else {
+    ++s.dropped;
+  }
+}
+
+}  // namespace
+
+void Tracer::set_enabled(bool enabled) {
+  now();
+  enabled_.store(enabled, std::memory_order_relaxed);
+}
+
+void Tracer::clear() {
+  trace_state& s = state();
+  std::lock_guard<std::mutex> lock(s.mutex);
+  s.events.clear();
+  s.dropped = 0;
+  s.latest_spans.clear();
+  s.latest_counters.clear();
+}
+
+std::int64_t Tracer::now() {
+  static const std::chrono::steady_clock::time_point epoch =
+      std::chrono::steady_clock::now();
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+      std::chrono::steady_clock::now() - epoch).count();
+}
+
+void Tracer::span(const char* name, std::int64_t begin, std::int64_t end) {
+  event e = {name, 'X', thread_index(), begin, end - begin, 0.0};
+  record(e);
+}
+
+void Tracer::record_count(const char* name, double value) {
+  event e = {name, 'C', thread_index(), now(), 0, value};
+  record(e);
+}
+
+void Tracer::latest(std::vector<value>* spans, std::vector<value>* counters) {
+  trace_state& s = state();
+  std::lock_guard<std::mutex> lock(s.mutex);
+  *spans = s.latest_spans;
+  *counters = s.latest_counters;
+}
+
+bool Tracer::write_chrome_trace(const std::string& file_path,
+                                std::string* error) {
+  std::ofstream out(file_path.c_str());
+  if (!out) {
+    if (error) {
+      *error = "Unable to open file " + file_path;
+    }
+    return false;
+  }
+  trace_state& s = state();
+  std::lock_guard<std::mutex> lock(s.mutex);
+  out << "{\"displayTimeUnit\": \"ms\", \"otherData\": {\"dropped_events\": "
+      << s.dropped << "}, \"traceEvents\": [";
+  for (std::size_t i = 0; i < s.events.size(); ++i) {
+    const event& e = s.events[i];
+    out << (i == 0 ? "\n" : ",\n")
+        << "{\"name\": \"" << e.name << "\", \"ph\": \"" << e.phase
+        << "\", \"pid\": 1, \"tid\": " << e.thread << ", \"ts\": " << e.begin;
+    if (e.phase == 'X') {
+      out << ", \"dur\": " << e.duration << "}";
+    } else {
+      out << ", \"args\": {\"value\": " << e.value << "}}";
+    }
+  }
+  out << "\n]}\n";
+  if (!out) {
+    if (error) {
+      *error = "Unable to write file " + file_path;
+    }
+    return false;
+  }
+  return true;
+}
@@ -0,0 +1,74 @@
+#ifndef TRACER_H
+#define TRACER_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Collects timed spans and counter values from any thread while enabled,
+// for export as a Chrome trace, which chrome://tracing and Perfetto open.
+// Disabled, which it is by default, a trace_scope or count() costs one
+// relaxed atomic load. Names must be string literals, only the pointers
+// are kept.
+class Tracer {
+ public:
+  // Latest duration of a span in milliseconds, or value of a counter.
+  struct value {
+    const char* name;
+    double value;
+  };
+
+  static bool enabled() { return enabled_.load(std::memory_order_relaxed); }
+  static void set_enabled(bool enabled);
+
+  // Drops everything recorded.
+  static void clear();
+
+  // Microseconds since an arbitrary point before the first event.
+  static std::int64_t now();
+
+  static void span(const char* name, std::int64_t begin, std::int64_t end);
+  static void count(const char* name, double value) {
+    if (enabled()) {
+      record_count(name, value);
+    }
+  }
+
+  // The latest duration of every span name and value of every counter, in
+  // the order they were first recorded, e.g. for an overlay.
+  static void latest(std::vector<value>* spans, std::vector<value>* counters);
+
+  // Writes the recorded events in the Chrome trace event format. Returns
+  // false and sets error if the file cannot be written.
+  static bool write_chrome_trace(const std::string& file_path,
+                                 std::string* error);
+
+ private:
+  static void record_count(const char* name, double value);
+
+  static std::atomic<bool> enabled_;
+};
+
+// Records the time from its construction to its destruction as a span, if
+// the tracer was enabled at construction.
+class trace_scope {
+ public:
+  explicit trace_scope(const char* name)
+      : name_(name), begin_(Tracer::enabled() ? Tracer::now() : -1) {}
+  ~trace_scope() {
+    if (begin_ >= 0) {
+      Tracer::span(name_, begin_, Tracer::now());
+    }
+  }
+
+ private:
+  trace_scope(const trace_scope&);
+  trace_scope& operator=(const trace_scope&);
+
+  const char* name_;
+  std::int64_t begin_;
+};
+
+#endif // TRACER_H
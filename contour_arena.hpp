@@ -0,0 +1,147 @@
+#ifndef CONTOUR_ARENA_HPP
+#define CONTOUR_ARENA_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "exact_predicates.hpp"
+
+// Closed contours stored back to back in one pair of coordinate arrays:
+// the vertices of contour i are xs(i)[0, size(i)), the first vertex is not
+// repeated. The bounding box, signed area and orientation of a contour are
+// computed once as it is closed. clear() keeps the capacity, so refilling an
+// arena of similar size does not allocate.
+class contour_arena {
+ public:
+  struct box {
+    std::int32_t xl, yl, xh, yh;
+  };
+
+  contour_arena() : offsets_(1, 0) {}
+
+  void clear() {
+    xs_.clear();
+    ys_.clear();
+    offsets_.assign(1, 0);
+    boxes_.clear();
+    area_.clear();
+    orientation_.clear();
+    twice_area_ = wide_int();
+  }
+
+  void reserve(std::size_t num_contours, std::size_t num_vertices) {
+    xs_.reserve(num_vertices);
+    ys_.reserve(num_vertices);
+    offsets_.reserve(num_contours + 1);
+    boxes_.reserve(num_contours);
+    area_.reserve(num_contours);
+    orientation_.reserve(num_contours);
+  }
+
+  // Appends a vertex to the contour being added.
+  void push_vertex(std::int32_t x, std::int32_t y) {
+    std::size_t first = offsets_.back();
+    if (xs_.size() == first) {
+      box b = {x, y, x, y};
+      current_ = b;
+    } else {
+      // the area is summed over the edges as they come, the closing edge
+      // is added by close().
+      twice_area_ += cross(xs_.back(), ys_.back(), x, y);
+      current_.xl = x < current_.xl ? x : current_.xl;
+      current_.yl = y < current_.yl ? y : current_.yl;
+      current_.xh = x > current_.xh ? x : current_.xh;
+      current_.yh = y > current_.yh ? y : current_.yh;
+    }
+    xs_.push_back(x);
+    ys_.push_back(y);
+  }
+
+  // Completes the contour being added. Does nothing if it has no vertex.
+  void close() {
+    std::size_t first = offsets_.back();
+    if (xs_.size() == first) {
+      return;
+    }
+    twice_area_ += cross(xs_.back(), ys_.back(), xs_[first], ys_[first]);
+    offsets_.push_back(static_cast<std::uint32_t>(xs_.size()));
+    boxes_.push_back(current_);
+    area_.push_back(twice_area_.to_double() / 2);
+    orientation_.push_back(static_cast<signed char>(twice_area_.sign()));
+    twice_area_ = wide_int();
+  }
+
+  // Removes contour i, the contours after it move down by one. Linear in
+  // the number of vertices after it.
+  void erase(std::size_t i) {
+    std::uint32_t first = offsets_[i];
+    std::uint32_t n = offsets_[i + 1] - first;
+    xs_.erase(xs_.begin() + first, xs_.begin() + first + n);
+    ys_.erase(ys_.begin() + first, ys_.begin() + first + n);
+    offsets_.erase(offsets_.begin() + i + 1);
+    for (std::size_t j = i + 1; j < offsets_.size(); ++j) {
+      offsets_[j] -= n;
+    }
+    boxes_.erase(boxes_.begin() + i);
+    area_.erase(area_.begin() + i);
+    orientation_.erase(orientation_.begin() + i);
+  }
+
+  // Shifts contour i by (dx, dy), which keeps its area and orientation. The
+  // shifted box must stay within the int32 range.
+  void translate(std::size_t i, std::int32_t dx, std::int32_t dy) {
+    for (std::size_t j = offsets_[i]; j < offsets_[i + 1]; ++j) {
+      xs_[j] += dx;
+      ys_[j] += dy;
+    }
+    box& b = boxes_[i];
+    b.xl += dx;
+    b.yl += dy;
+    b.xh += dx;
+    b.yh += dy;
+  }
+
+  std::size_t size() const { return boxes_.size(); }
+  bool empty() const { return boxes_.empty(); }
+  std::size_t num_vertices() const { return offsets_.back(); }
+  // Bytes held, including the capacity kept by clear().
+  std::size_t capacity_bytes() const {
+    return (xs_.capacity() + ys_.capacity()) * sizeof(std::int32_t) +
+           offsets_.capacity() * sizeof(std::uint32_t) +
+           boxes_.capacity() * sizeof(box) +
+           area_.capacity() * sizeof(double) +
+           orientation_.capacity() * sizeof(signed char);
+  }
+
+  // index of the first vertex of contour i in the whole arena.
+  std::size_t begin(std::size_t i) const { return offsets_[i]; }
+  std::size_t size(std::size_t i) const {
+    return offsets_[i + 1] - offsets_[i];
+  }
+  const std::int32_t* xs(std::size_t i) const {
+    return xs_.data() + offsets_[i];
+  }
+  const std::int32_t* ys(std::size_t i) const {
+    return ys_.data() + offsets_[i];
+  }
+  const box& bounds(std::size_t i) const { return boxes_[i]; }
+  // positive if contour i is counter-clockwise, rounded to double.
+  double area(std::size_t i) const { return area_[i]; }
+  // sign of area(i), but exact: 1 if contour i is counter-clockwise, -1 if
+  // clockwise, 0 if it has no area.
+  int orientation(std::size_t i) const { return orientation_[i]; }
+
+ private:
+  std::vector<std::int32_t> xs_;
+  std::vector<std::int32_t> ys_;
+  std::vector<std::uint32_t> offsets_;
+  std::vector<box> boxes_;
+  std::vector<double> area_;
+  std::vector<signed char> orientation_;
+  // of the contour being added.
+  box current_;
+  wide_int twice_area_;
+};
+
+#endif  // CONTOUR_ARENA_HPP
@@ -0,0 +1,593 @@
+#ifndef EAR_TRIANGULATION_HPP
+#define EAR_TRIANGULATION_HPP
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <deque>
+#include <limits>
+#include <vector>
+
+#include <boost/polygon/point_concept.hpp>
+
+// Triangulates a polygon with holes by ear clipping, after the earcut
+// algorithm: holes are bridged into the outer boundary from their leftmost
+// vertex, then ears are cut off the resulting ring. Ears are tested against
+// the reflex vertices near them found through a z-order curve, so large
+// polygons do not need a quadratic scan. If no ear is left because of
+// degeneracies, touching vertices are resolved and finally the ring is
+// split along a valid diagonal.
+//
+// The triangles only use the input vertices, so the union of the
+// triangles is the polygon exactly. Rings may have any orientation; the
+// first ring is the outer boundary, the others are its holes.
+template <typename Point>
+class ear_triangulation {
+ public:
+  // Appends three vertices per triangle, counter-clockwise.
+  static void run(const std::vector<std::vector<Point>>& rings,
+                  std::vector<Point>* triangles) {
+    if (rings.empty()) {
+      return;
+    }
+    ear_triangulation t;
+    t.triangles_ = triangles;
+    node* outer = t.linked_list(rings[0], true);
+    if (outer == NULL || outer->next == outer->prev) {
+      return;
+    }
+    if (rings.size() > 1) {
+      outer = t.eliminate_holes(rings, outer);
+    }
+    // the z-order index only pays off for larger rings.
+    std::size_t num_vertices = 0;
+    for (const auto& ring : rings) {
+      num_vertices += ring.size();
+    }
+    if (num_vertices > 80) {
+      const auto& outer_ring = rings[0];
+      t.min_x_ = t.max_x_ = boost::polygon::x(outer_ring[0]);
+      t.min_y_ = t.max_y_ = boost::polygon::y(outer_ring[0]);
+      for (const auto& p : outer_ring) {
+        double px = boost::polygon::x(p);
+        double py = boost::polygon::y(p);
+        t.min_x_ = (std::min)(t.min_x_, px);
+        t.min_y_ = (std::min)(t.min_y_, py);
+        t.max_x_ = (std::max)(t.max_x_, px);
+        t.max_y_ = (std::max)(t.max_y_, py);
+      }
+      double size = (std::max)(t.max_x_ - t.min_x_, t.max_y_ - t.min_y_);
+      t.inv_size_ = size != 0 ? 32767 / size : 0;
+    }
+    t.earcut_linked(outer, 0);
+  }
+
+ private:
+  struct node {
+    node(double x_, double y_, std::size_t i_)
+        : i(i_), x(x_), y(y_), prev(NULL), next(NULL), z(0),
+          prev_z(NULL), next_z(NULL), steiner(false) {}
+
+    // input vertex, shared by the two copies of a bridge end.
+    std::size_t i;
+    double x, y;
+    node* prev;
+    node* next;
+    std::int32_t z;
+    node* prev_z;
+    node* next_z;
+    bool steiner;
+  };
+
+  ear_triangulation() : min_x_(0), min_y_(0), max_x_(0), max_y_(0),
+                        inv_size_(0), triangles_(NULL) {}
+
+  // Twice the signed area of triangle p, q, r, negative if it turns left.
+  static double area(const node* p, const node* q, const node* r) {
+    return (q->y - p->y) * (r->x - q->x) - (q->x - p->x) * (r->y - q->y);
+  }
+
+  static bool equals(const node* p, const node* q) {
+    return p->x == q->x && p->y == q->y;
+  }
+
+  static bool point_in_triangle(double ax, double ay, double bx, double by,
+                                double cx, double cy, double px, double py) {
+    return (cx - px) * (ay - py) >= (ax - px) * (cy - py) &&
+           (ax - px) * (by - py) >= (bx - px) * (ay - py) &&
+           (bx - px) * (cy - py) >= (cx - px) * (by - py);
+  }
+
+  static int sign(double value) {
+    return (value > 0) - (value < 0);
+  }
+
+  // q lies on segment p r, given the three are collinear.
+  static bool on_segment(const node* p, const node* q, const node* r) {
+    return q->x <= (std::max)(p->x, r->x) && q->x >= (std::min)(p->x, r->x) &&
+           q->y <= (std::max)(p->y, r->y) && q->y >= (std::min)(p->y, r->y);
+  }
+
+  static bool intersects(const node* p1, const node* q1,
+                         const node* p2, const node* q2) {
+    int o1 = sign(area(p1, q1, p2));
+    int o2 = sign(area(p1, q1, q2));
+    int o3 = sign(area(p2, q2, p1));
+    int o4 = sign(area(p2, q2, q1));
+    if (o1 != o2 && o3 != o4) {
+      return true;
+    }
+    return (o1 == 0 && on_segment(p1, p2, q1)) ||
+           (o2 == 0 && on_segment(p1, q2, q1)) ||
+           (o3 == 0 && on_segment(p2, p1, q2)) ||
+           (o4 == 0 && on_segment(p2, q1, q2));
+  }
+
+  // Tells whether diagonal a b crosses any edge of the ring.
+  static bool intersects_polygon(const node* a, const node* b) {
+    const node* p = a;
+    do {
+      if (p->i != a->i && p->next->i != a->i && p->i != b->i &&
+          p->next->i != b->i && intersects(p, p->next, a, b)) {
+        return true;
+      }
+      p = p->next;
+    } while (p != a);
+    return false;
+  }
+
+  static bool locally_inside(const node* a, const node* b) {
+    return area(a->prev, a, a->next) < 0 ?
+        area(a, b, a->next) >= 0 && area(a, a->prev, b) >= 0 :
+        area(a, b, a->prev) < 0 || area(a, a->next, b) < 0;
+  }
+
+  static bool middle_inside(const node* a, const node* b) {
+    const node* p = a;
+    bool inside = false;
+    double px = (a->x + b->x) / 2;
+    double py = (a->y + b->y) / 2;
+    do {
+      if ((p->y > py) != (p->next->y > py) && p->next->y != p->y &&
+          px < (p->next->x - p->x) * (py - p->y) / (p->next->y - p->y) +
+                   p->x) {
+        inside = !inside;
+      }
+      p = p->next;
+    } while (p != a);
+    return inside;
+  }
+
+  static bool is_valid_diagonal(const node* a, const node* b) {
+    return a->next->i != b->i && a->prev->i != b->i &&
+           !intersects_polygon(a, b) &&
+           ((locally_inside(a, b) && locally_inside(b, a) &&
+             middle_inside(a, b) &&
+             (area(a->prev, a, b->prev) != 0 || area(a, b->prev, b) != 0)) ||
+            (equals(a, b) && area(a->prev, a, a->next) > 0 &&
+             area(b->prev, b, b->next) > 0));
+  }
+
+  static bool sector_contains_sector(const node* m, const node* p) {
+    return area(m->prev, m, p->prev) < 0 && area(p->next, m, m->next) < 0;
+  }
+
+  static void remove_node(node* p) {
+    p->next->prev = p->prev;
+    p->prev->next = p->next;
+    if (p->prev_z) {
+      p->prev_z->next_z = p->next_z;
+    }
+    if (p->next_z) {
+      p->next_z->prev_z = p->prev_z;
+    }
+  }
+
+  node* insert_node(const Point& point, std::size_t i, node* last) {
+    nodes_.push_back(
+        node(boost::polygon::x(point), boost::polygon::y(point), i));
+    node* p = &nodes_.back();
+    if (last == NULL) {
+      p->prev = p;
+      p->next = p;
+    } else {
+      p->next = last->next;
+      p->prev = last;
+      last->next->prev = p;
+      last->next = p;
+    }
+    return p;
+  }
+
+  // Links a ring counter-clockwise for the outer boundary and clockwise for
+  // holes.
+  node* linked_list(const std::vector<Point>& ring, bool outer) {
+    if (ring.empty()) {
+      return NULL;
+    }
+    double twice_area = 0;
+    for (std::size_t i = 0, j = ring.size() - 1; i < ring.size(); j = i++) {
+      twice_area += (static_cast<double>(boost::polygon::x(ring[j])) -
+                     boost::polygon::x(ring[i])) *
+                    (static_cast<double>(boost::polygon::y(ring[i])) +
+                     boost::polygon::y(ring[j]));
+    }
+    node* last = NULL;
+    if (outer == (twice_area > 0)) {
+      for (std::size_t i = 0; i < ring.size(); ++i) {
+        last = insert_node(ring[i], inputs_.size() + i, last);
+      }
+    } else {
+      for (std::size_t i = ring.size(); i-- > 0;) {
+        last = insert_node(ring[i], inputs_.size() + i, last);
+      }
+    }
+    inputs_.insert(inputs_.end(), ring.begin(), ring.end());
+    if (last != NULL && equals(last, last->next)) {
+      remove_node(last);
+      last = last->next;
+    }
+    return last;
+  }
+
+  // Drops duplicate and collinear vertices between start and end.
+  node* filter_points(node* start, node* end = NULL) {
+    if (start == NULL) {
+      return start;
+    }
+    if (end == NULL) {
+      end = start;
+    }
+    node* p = start;
+    bool again;
+    do {
+      again = false;
+      if (!p->steiner &&
+          (equals(p, p->next) || area(p->prev, p, p->next) == 0)) {
+        remove_node(p);
+        p = end = p->prev;
+        if (p == p->next) {
+          break;
+        }
+        again = true;
+      } else {
+        p = p->next;
+      }
+    } while (again || p != end);
+    return end;
+  }
+
+  void add_triangle(const node* a, const node* b, const node* c) {
+    triangles_->push_back(inputs_[a->i]);
+    triangles_->push_back(inputs_[b->i]);
+    triangles_->push_back(inputs_[c->i]);
+  }
+
+  void earcut_linked(node* ear, int pass) {
+    if (ear == NULL) {
+      return;
+    }
+    if (pass == 0 && inv_size_ != 0) {
+      index_curve(ear);
+    }
+    node* stop = ear;
+    while (ear->prev != ear->next) {
+      node* prev = ear->prev;
+      node* next = ear->next;
+      if (inv_size_ != 0 ? is_ear_hashed(ear) : is_ear(ear)) {
+        add_triangle(prev, ear, next);
+        remove_node(ear);
+        // skipping the next vertex leads to fewer sliver triangles.
+        ear = next->next;
+        stop = next->next;
+        continue;
+      }
+      ear = next;
+      if (ear == stop) {
+        if (pass == 0) {
+          earcut_linked(filter_points(ear), 1);
+        } else if (pass == 1) {
+          ear = cure_local_intersections(filter_points(ear));
+          earcut_linked(ear, 2);
+        } else {
+          split_earcut(ear);
+        }
+        break;
+      }
+    }
+  }
+
+  static bool is_ear(const node* ear) {
+    const node* a = ear->prev;
+    const node* b = ear;
+    const node* c = ear->next;
+    if (area(a, b, c) >= 0) {
+      return false;
+    }
+    for (const node* p = c->next; p != a; p = p->next) {
+      if (point_in_triangle(a->x, a->y, b->x, b->y, c->x, c->y, p->x, p->y) &&
+          area(p->prev, p, p->next) >= 0) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  bool is_ear_hashed(const node* ear) const {
+    const node* a = ear->prev;
+    const node* b = ear;
+    const node* c = ear->next;
+    if (area(a, b, c) >= 0) {
+      return false;
+    }
+    double x0 = (std::min)((std::min)(a->x, b->x), c->x);
+    double y0 = (std::min)((std::min)(a->y, b->y), c->y);
+    double x1 = (std::max)((std::max)(a->x, b->x), c->x);
+    double y1 = (std::max)((std::max)(a->y, b->y), c->y);
+    std::int32_t min_z = z_order(x0, y0);
+    std::int32_t max_z = z_order(x1, y1);
+    auto blocks = [&](const node* p) {
+      return p->x >= x0 && p->x <= x1 && p->y >= y0 && p->y <= y1 &&
+             p != a && p != c &&
+             point_in_triangle(a->x, a->y, b->x, b->y, c->x, c->y,
+                               p->x, p->y) &&
+             area(p->prev, p, p->next) >= 0;
+    };
+    // look both ways along the curve, first in turns.
+    const node* p = ear->prev_z;
+    const node* n = ear->next_z;
+    while (p != NULL && p->z >= min_z && n != NULL && n->z <= max_z) {
+      if (blocks(p) || blocks(n)) {
+        return false;
+      }
+      p = p->prev_z;
+      n = n->next_z;
+    }
+    for (; p != NULL && p->z >= min_z; p = p->prev_z) {
+      if (blocks(p)) {
+        return false;
+      }
+    }
+    for (; n != NULL && n->z <= max_z; n = n->next_z) {
+      if (blocks(n)) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  // Cuts off the triangles of local self-intersections a p p->next b.
+  node* cure_local_intersections(node* start) {
+    node* p = start;
+    do {
+      node* a = p->prev;
+      node* b = p->next->next;
+      if (!equals(a, b) && intersects(a, p, p->next, b) &&
+          locally_inside(a, b) && locally_inside(b, a)) {
+        add_triangle(a, p, b);
+        remove_node(p);
+        remove_node(p->next);
+        p = start = b;
+      }
+      p = p->next;
+    } while (p != start);
+    return filter_points(p);
+  }
+
+  void split_earcut(node* start) {
+    node* a = start;
+    do {
+      for (node* b = a->next->next; b != a->prev; b = b->next) {
+        if (a->i != b->i && is_valid_diagonal(a, b)) {
+          node* c = split_polygon(a, b);
+          a = filter_points(a, a->next);
+          c = filter_points(c, c->next);
+          earcut_linked(a, 0);
+          earcut_linked(c, 0);
+          return;
+        }
+      }
+      a = a->next;
+    } while (a != start);
+  }
+
+  node* eliminate_holes(const std::vector<std::vector<Point>>& rings,
+                        node* outer) {
+    std::vector<node*> queue;
+    for (std::size_t r = 1; r < rings.size(); ++r) {
+      node* list = linked_list(rings[r], false);
+      if (list == NULL) {
+        continue;
+      }
+      if (list == list->next) {
+        list->steiner = true;
+      }
+      queue.push_back(leftmost(list));
+    }
+    std::sort(queue.begin(), queue.end(),
+              [](const node* a, const node* b) { return a->x < b->x; });
+    for (node* hole : queue) {
+      outer = eliminate_hole(hole, outer);
+    }
+    return outer;
+  }
+
+  node* eliminate_hole(node* hole, node* outer) {
+    node* bridge = find_hole_bridge(hole, outer);
+    if (bridge == NULL) {
+      return outer;
+    }
+    node* bridge_reverse = split_polygon(bridge, hole);
+    filter_points(bridge_reverse, bridge_reverse->next);
+    return filter_points(bridge, bridge->next);
+  }
+
+  // Finds a vertex of the outer ring visible from the leftmost vertex of
+  // the hole.
+  static node* find_hole_bridge(const node* hole, node* outer) {
+    node* p = outer;
+    double hx = hole->x;
+    double hy = hole->y;
+    double qx = -std::numeric_limits<double>::infinity();
+    node* m = NULL;
+    // the nearest edge left of the hole vertex on its horizontal.
+    do {
+      if (hy <= p->y && hy >= p->next->y && p->next->y != p->y) {
+        double x = p->x +
+            (hy - p->y) * (p->next->x - p->x) / (p->next->y - p->y);
+        if (x <= hx && x > qx) {
+          qx = x;
+          m = p->x < p->next->x ? p : p->next;
+          if (x == hx) {
+            // the hole touches the edge, bridge to its leftmost end.
+            return m;
+          }
+        }
+      }
+      p = p->next;
+    } while (p != outer);
+    if (m == NULL) {
+      return NULL;
+    }
+    // a reflex vertex inside the triangle of hole vertex, hit point and m
+    // may block the view, take the one with the smallest angle instead.
+    const node* stop = m;
+    double mx = m->x;
+    double my = m->y;
+    double tan_min = std::numeric_limits<double>::infinity();
+    p = m;
+    do {
+      if (hx >= p->x && p->x >= mx && hx != p->x &&
+          point_in_triangle(hy < my ? hx : qx, hy, mx, my,
+                            hy < my ? qx : hx, hy, p->x, p->y)) {
+        double tan = std::fabs(hy - p->y) / (hx - p->x);
+        if (locally_inside(p, hole) &&
+            (tan < tan_min ||
+             (tan == tan_min &&
+              (p->x > m->x ||
+               (p->x == m->x && sector_contains_sector(m, p)))))) {
+          m = p;
+          tan_min = tan;
+        }
+      }
+      p = p->next;
+    } while (p != stop);
+    return m;
+  }
+
+  static node* leftmost(node* start) {
+    node* p = start;
+    node* result = start;
+    do {
+      if (p->x < result->x || (p->x == result->x && p->y < result->y)) {
+        result = p;
+      }
+      p = p->next;
+    } while (p != start);
+    return result;
+  }
+
+  // Links a to b with a bridge, splitting the ring in two. Returns the
+  // copy of b on the other ring.
+  node* split_polygon(node* a, node* b) {
+    nodes_.push_back(node(a->x, a->y, a->i));
+    node* a2 = &nodes_.back();
+    nodes_.push_back(node(b->x, b->y, b->i));
+    node* b2 = &nodes_.back();
+    node* an = a->next;
+    node* bp = b->prev;
+    a->next = b;
+    b->prev = a;
+    a2->next = an;
+    an->prev = a2;
+    b2->next = a2;
+    a2->prev = b2;
+    bp->next = b2;
+    b2->prev = bp;
+    return b2;
+  }
+
+  // Interleaves the bits of the 15-bit cell coordinates.
+  std::int32_t z_order(double px, double py) const {
+    std::int32_t x = static_cast<std::int32_t>((px - min_x_) * inv_size_);
+    std::int32_t y = static_cast<std::int32_t>((py - min_y_) * inv_size_);
+    x = (x | (x << 8)) & 0x00FF00FF;
+    x = (x | (x << 4)) & 0x0F0F0F0F;
+    x = (x | (x << 2)) & 0x33333333;
+    x = (x | (x << 1)) & 0x55555555;
+    y = (y | (y << 8)) & 0x00FF00FF;
+    y = (y | (y << 4)) & 0x0F0F0F0F;
+    y = (y | (y << 2)) & 0x33333333;
+    y = (y | (y << 1)) & 0x55555555;
+    return x | (y << 1);
+  }
+
+  void index_curve(node* start) {
+    node* p = start;
+    do {
+      p->z = z_order(p->x, p->y);
+      p->prev_z = p->prev;
+      p->next_z = p->next;
+      p = p->next;
+    } while (p != start);
+    p->prev_z->next_z = NULL;
+    p->prev_z = NULL;
+    sort_linked(p);
+  }
+
+  // Merge sort of the z list, in place.
+  static node* sort_linked(node* list) {
+    int num_merges;
+    int in_size = 1;
+    do {
+      node* p = list;
+      list = NULL;
+      node* tail = NULL;
+      num_merges = 0;
+      while (p != NULL) {
+        ++num_merges;
+        node* q = p;
+        int p_size = 0;
+        for (int i = 0; i < in_size && q != NULL; ++i) {
+          ++p_size;
+          q = q->next_z;
+        }
+        int q_size = in_size;
+        while (p_size > 0 || (q_size > 0 && q != NULL)) {
+          node* e;
+          if (p_size != 0 &&
+              (q_size == 0 || q == NULL || p->z <= q->z)) {
+            e = p;
+            p = p->next_z;
+            --p_size;
+          } else {
+            e = q;
+            q = q->next_z;
+            --q_size;
+          }
+          if (tail != NULL) {
+            tail->next_z = e;
+          } else {
+            list = e;
+          }
+          e->prev_z = tail;
+          tail = e;
+        }
+        p = q;
+      }
+      tail->next_z = NULL;
+      in_size *= 2;
+    } while (num_merges > 1);
+    return list;
+  }
+
+  // stable addresses for the linked nodes.
+  std::deque<node> nodes_;
+  // the vertices of all rings in input order, indexed by node::i.
+  std::vector<Point> inputs_;
+  double min_x_, min_y_, max_x_, max_y_;
+  double inv_size_;
+  std::vector<Point>* triangles_;
+};
+
+#endif  // EAR_TRIANGULATION_HPP
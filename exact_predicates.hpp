@@ -0,0 +1,114 @@
+#ifndef EXACT_PREDICATES_HPP
+#define EXACT_PREDICATES_HPP
+
+#include <cstdint>
+
+#if defined(_MSC_VER) && defined(_M_X64) && !defined(__SIZEOF_INT128__)
+#include <intrin.h>
+#endif
+
+// Exact arithmetic on the products of coordinate differences. Differences
+// of 32-bit coordinates need 33 bits and their products 66, more than any
+// built-in type every compiler has: long double is a plain double on MSVC.
+// wide_int holds 128 bits in two's complement, which also leaves room to
+// sum the products over the edges of a contour.
+class wide_int {
+ public:
+  wide_int() : hi_(0), lo_(0) {}
+
+  // a * b, exact for any 64-bit operands.
+  static wide_int product(std::int64_t a, std::int64_t b) {
+#if defined(__SIZEOF_INT128__)
+    unsigned __int128 p =
+        static_cast<unsigned __int128>(static_cast<__int128>(a) * b);
+    return wide_int(static_cast<std::uint64_t>(p >> 64),
+                    static_cast<std::uint64_t>(p));
+#elif defined(_MSC_VER) && defined(_M_X64)
+    std::int64_t hi;
+    std::uint64_t lo = static_cast<std::uint64_t>(_mul128(a, b, &hi));
+    return wide_int(static_cast<std::uint64_t>(hi), lo);
+#else
+    return split_product(a, b);
+#endif
+  }
+
+  // The same from 32-bit halves, for compilers with neither __int128 nor
+  // _mul128.
+  static wide_int split_product(std::int64_t a, std::int64_t b) {
+    bool negative = (a < 0) != (b < 0);
+    // negated as unsigned, which is defined for INT64_MIN too.
+    std::uint64_t ua = a < 0 ? 0 - static_cast<std::uint64_t>(a)
+                             : static_cast<std::uint64_t>(a);
+    std::uint64_t ub = b < 0 ? 0 - static_cast<std::uint64_t>(b)
+                             : static_cast<std::uint64_t>(b);
+    const std::uint64_t mask = 0xffffffffu;
+    std::uint64_t ll = (ua & mask) * (ub & mask);
+    std::uint64_t lh = (ua & mask) * (ub >> 32);
+    std::uint64_t hl = (ua >> 32) * (ub & mask);
+    std::uint64_t hh = (ua >> 32) * (ub >> 32);
+    std::uint64_t middle = (ll >> 32) + (lh & mask) + (hl & mask);
+    wide_int p((hh + (lh >> 32) + (hl >> 32) + (middle >> 32)),
+               (middle << 32) | (ll & mask));
+    return negative ? -p : p;
+  }
+
+  wide_int operator-() const {
+    // ~x + 1, carrying into hi_ when lo_ is zero.
+    return wide_int(~hi_ + (lo_ == 0 ? 1 : 0), ~lo_ + 1);
+  }
+  wide_int& operator+=(const wide_int& that) {
+    std::uint64_t lo = lo_ + that.lo_;
+    hi_ += that.hi_ + (lo < lo_ ? 1 : 0);
+    lo_ = lo;
+    return *this;
+  }
+  wide_int& operator-=(const wide_int& that) { return *this += -that; }
+
+  // 1, 0 or -1.
+  int sign() const {
+    if (hi_ >> 63) {
+      return -1;
+    }
+    return (hi_ | lo_) != 0 ? 1 : 0;
+  }
+
+  // Rounded to double.
+  double to_double() const {
+    if (hi_ >> 63) {
+      return -(-*this).to_double();
+    }
+    return static_cast<double>(hi_) * 18446744073709551616.0 +
+           static_cast<double>(lo_);
+  }
+
+ private:
+  wide_int(std::uint64_t hi, std::uint64_t lo) : hi_(hi), lo_(lo) {}
+
+  // unsigned, so that carries wrap instead of overflowing.
+  std::uint64_t hi_;
+  std::uint64_t lo_;
+};
+
+// ux * vy - uy * vx exactly, the cross product of (ux, uy) and (vx, vy).
+// The operands may take up to 62 bits.
+inline wide_int cross(std::int64_t ux, std::int64_t uy, std::int64_t vx,
+                      std::int64_t vy) {
+  wide_int c = wide_int::product(ux, vy);
+  c -= wide_int::product(uy, vx);
+  return c;
+}
+
+// Sign of cross(ux, uy, vx, vy): 1 if (vx, vy) turns counter-clockwise from
+// (ux, uy), -1 if clockwise, 0 if they are parallel.
+inline int cross_sign(std::int64_t ux, std::int64_t uy, std::int64_t vx,
+                      std::int64_t vy) {
+#if defined(__SIZEOF_INT128__)
+  __int128 lhs = static_cast<__int128>(ux) * vy;
+  __int128 rhs = static_cast<__int128>(uy) * vx;
+  return (lhs > rhs) - (lhs < rhs);
+#else
+  return cross(ux, uy, vx, vy).sign();
+#endif
+}
+
+#endif  // EXACT_PREDICATES_HPP
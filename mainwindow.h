@@ -10,7 +10,9 @@ class MainWindow : public QWidget {
  public:
   MainWindow() {
     glWidget_ = new GLWidget();
-    file_dir_ = QDir(QDir::currentPath(), tr("*.txt"));
+    connect(glWidget_, SIGNAL(built(QString)),
+            this, SLOT(build_finished(QString)));
+    file_dir_ = QDir(QDir::currentPath(), tr("*.txt *.msop"));
     file_name_ = tr("");
 
     QHBoxLayout* centralLayout = new QHBoxLayout;
@@ -32,6 +34,30 @@ class MainWindow : public QWidget {
     glWidget_->show_internal_edges_only();
   }
 
+  void frame_time() {
+    glWidget_->show_frame_time();
+  }
+
+  void trace() {
+    Tracer::set_enabled(!Tracer::enabled());
+    glWidget_->show_trace();
+  }
+
+  void save_trace() {
+    QString output_file = QFileDialog::getSaveFileName(
+        0, tr("Save Trace"), file_dir_.absolutePath() + tr("/trace.json"),
+        tr("Chrome trace (*.json)"));
+    if (output_file.isEmpty()) {
+      return;
+    }
+    std::string error;
+    if (!Tracer::write_chrome_trace(output_file.toLocal8Bit().constData(),
+                                    &error)) {
+      QMessageBox::warning(this, tr("Voronoi Visualizer"),
+                           QString::fromStdString(error));
+    }
+  }
+
   void browse() {
     QString new_path = QFileDialog::getExistingDirectory(
         0, tr("Choose Directory"), file_dir_.absolutePath());
@@ -43,10 +69,16 @@ class MainWindow : public QWidget {
   }
 
   void build() {
-    file_name_ = file_list_->currentItem()->text();
-    QString file_path = file_dir_.filePath(file_name_);
+    QString file_path =
+        file_dir_.filePath(file_list_->currentItem()->text());
     message_label_->setText("Building...");
     glWidget_->build(file_path);
+  }
+
+  void build_finished(const QString& file_path) {
+    // only now is the layout on screen, the request may have been
+    // superseded since, by another file or a rebuild for the diagram.
+    file_name_ = QFileInfo(file_path).fileName();
     message_label_->setText("Double click the item to build voronoi diagram:");
     setWindowTitle(tr("Voronoi Visualizer - ") + file_path);
   }
@@ -80,6 +112,13 @@ class MainWindow : public QWidget {
     connect(internal_checkbox, SIGNAL(clicked()),
         this, SLOT(internal_edges_only()));
 
+    QCheckBox* frame_time_checkbox = new QCheckBox("Show frame time.");
+    connect(frame_time_checkbox, SIGNAL(clicked()),
+        this, SLOT(frame_time()));
+
+    QCheckBox* trace_checkbox = new QCheckBox("Trace build and paint.");
+    connect(trace_checkbox, SIGNAL(clicked()), this, SLOT(trace()));
+
     QPushButton* browse_button =
         new QPushButton(tr("Browse Input Directory"));
     connect(browse_button, SIGNAL(clicked()), this, SLOT(browse()));
@@ -89,12 +128,19 @@ class MainWindow : public QWidget {
     connect(print_scr_button, SIGNAL(clicked()), this, SLOT(print_scr()));
     print_scr_button->setMinimumHeight(50);
 
+    QPushButton* save_trace_button = new QPushButton(tr("Save Trace"));
+    connect(save_trace_button, SIGNAL(clicked()), this, SLOT(save_trace()));
+    save_trace_button->setMinimumHeight(50);
+
     file_layout->addWidget(message_label_, 0, 0);
     file_layout->addWidget(file_list_, 1, 0);
     file_layout->addWidget(primary_checkbox, 2, 0);
     file_layout->addWidget(internal_checkbox, 3, 0);
-    file_layout->addWidget(browse_button, 4, 0);
-    file_layout->addWidget(print_scr_button, 5, 0);
+    file_layout->addWidget(frame_time_checkbox, 4, 0);
+    file_layout->addWidget(trace_checkbox, 5, 0);
+    file_layout->addWidget(browse_button, 6, 0);
+    file_layout->addWidget(print_scr_button, 7, 0);
+    file_layout->addWidget(save_trace_button, 8, 0);
 
     return file_layout;
   }
@@ -113,6 +159,7 @@ class MainWindow : public QWidget {
   }
 
   QDir file_dir_;
+  // the layout on screen, set when its build has finished.
   QString file_name_;
   GLWidget* glWidget_;
   QListWidget* file_list_;
@@ -0,0 +1,255 @@
+// Headless batch classification: reads layouts in the input text format or
+// the binary format of LayoutFormat.h and writes their material polygons,
+// without Qt or an OpenGL context.
+//
+// usage: material_batch [-o output_dir] [-j threads] [--stream [--verify]]
+//                       [--engine sweep|voronoi] <file or directory>...
+//
+// Directories are scanned for *.txt and *.msop files in name order. Every
+// input writes <output_dir>/<name>.txt holding the combined material
+// polygons, so inputs that differ only in their directory or extension,
+// e.g. a.txt and a.msop, are rejected rather than overwriting each other.
+//
+// Files are spread over worker threads, each owning its own LayoutClassifier
+// and therefore its own voronoi diagram and polygon buffers. Workers pull the
+// next file from a shared queue ordered by decreasing file size, so a few
+// large inputs do not end up behind many small ones on a single core. The
+// report is printed in input order once all files are done, whatever the
+// thread count. With fewer files than threads, the threads left over are
+// shared out to the builds, see LayoutClassifier::set_threads(), so a single
+// large file still uses all of them.
+//
+// With --stream every file goes through a StreamingClassifier instead, which
+// writes regions while the file is read and never holds the whole layout.
+// Regions then come out in the order they are completed rather than in
+// input order. --verify checks every point location of the streaming
+// classifier against the scalar kernel and Boost.Polygon, and fails the
+// files where they disagree.
+//
+// --engine picks how LayoutClassifier nests the contours, see
+// LayoutClassifier::nesting_engine. It does not apply to --stream.
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "LayoutClassifier.h"
+#include "LayoutFormat.h"
+#include "StreamingClassifier.h"
+
+namespace fs = std::filesystem;
+
+namespace {
+
+void usage() {
+  std::cerr << "usage: material_batch [-o output_dir] [-j threads] "
+               "[--stream [--verify]] [--engine sweep|voronoi] "
+               "<file or directory>...\n";
+}
+
+// Name of the file an input writes below the output directory.
+fs::path output_name(const fs::path& input) {
+  fs::path name = input.filename();
+  name.replace_extension(".txt");
+  return name;
+}
+
+// Expands directories into their *.txt and *.msop files, sorted like the
+// file list of the visualizer. Fails if two inputs would write the same
+// output.
+bool collect_inputs(const std::vector<std::string>& args,
+                    std::vector<fs::path>* inputs) {
+  for (const auto& arg : args) {
+    fs::path path(arg);
+    std::error_code ec;
+    if (fs::is_directory(path, ec)) {
+      std::vector<fs::path> files;
+      for (const auto& entry : fs::directory_iterator(path, ec)) {
+        fs::path extension = entry.path().extension();
+        if (entry.is_regular_file() &&
+            (extension == ".txt" || extension == LAYOUT_EXTENSION)) {
+          files.push_back(entry.path());
+        }
+      }
+      std::sort(files.begin(), files.end());
+      inputs->insert(inputs->end(), files.begin(), files.end());
+    } else if (fs::is_regular_file(path, ec)) {
+      inputs->push_back(path);
+    } else {
+      std::cerr << "material_batch: no such file or directory " << arg << "\n";
+      return false;
+    }
+  }
+  std::map<fs::path, fs::path> writers;
+  for (const auto& input : *inputs) {
+    auto inserted = writers.insert(std::make_pair(output_name(input), input));
+    if (!inserted.second) {
+      std::cerr << "material_batch: " << inserted.first->second.string()
+                << " and " << input.string() << " would both write "
+                << output_name(input).string() << "\n";
+      return false;
+    }
+  }
+  return true;
+}
+
+struct job {
+  fs::path input;
+  std::uintmax_t size;
+  bool ok;
+  std::string report;
+};
+
+void classify(const fs::path& output_dir, LayoutClassifier* layout, job* j) {
+  std::string error;
+  std::ostringstream report;
+  layout->clear();
+  j->ok = layout->read_data(j->input.string(), &error);
+  if (j->ok) {
+    layout->build();
+    fs::path output = output_dir / output_name(j->input);
+    j->ok = layout->write_material(output.string(), &error);
+  }
+  if (j->ok) {
+    report << j->input.string() << ": "
+           << layout->contours().size() << " contours, "
+           << layout->combined_polygon_set().size() << " material regions";
+  } else {
+    report << "material_batch: " << error;
+  }
+  j->report = report.str();
+}
+
+void classify_stream(const fs::path& output_dir, StreamingClassifier* stream,
+                     job* j) {
+  std::string error;
+  std::ostringstream report;
+  fs::path output = output_dir / output_name(j->input);
+  j->ok = stream->run(j->input.string(), output.string(), &error);
+  if (j->ok) {
+    const StreamingClassifier::stream_stats& stats = stream->statistics();
+    report << j->input.string() << ": "
+           << stats.contours << " contours, "
+           << stats.regions << " material regions, at most "
+           << stats.peak_contours << " contours held";
+    if (stats.verify_mismatches != 0) {
+      report << ", " << stats.verify_mismatches
+             << " point locations failed verification";
+      j->ok = false;
+    }
+  } else {
+    report << "material_batch: " << error;
+  }
+  j->report = report.str();
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  fs::path output_dir("material_out");
+  unsigned num_threads = std::max(1u, std::thread::hardware_concurrency());
+  bool stream = false;
+  bool verify = false;
+  LayoutClassifier::nesting_engine engine = LayoutClassifier::SWEEP_NESTING;
+  std::vector<std::string> args;
+  for (int i = 1; i < argc; ++i) {
+    std::string arg(argv[i]);
+    if (arg == "-o" && i + 1 < argc) {
+      output_dir = argv[++i];
+    } else if (arg == "-j" && i + 1 < argc) {
+      num_threads = std::max(1, std::atoi(argv[++i]));
+    } else if (arg == "--stream") {
+      stream = true;
+    } else if (arg == "--verify") {
+      verify = true;
+    } else if (arg == "--engine" && i + 1 < argc) {
+      std::string name(argv[++i]);
+      if (name == "sweep") {
+        engine = LayoutClassifier::SWEEP_NESTING;
+      } else if (name == "voronoi") {
+        engine = LayoutClassifier::VORONOI_NESTING;
+      } else {
+        usage();
+        return 2;
+      }
+    } else if (arg == "-h" || arg == "--help") {
+      usage();
+      return 0;
+    } else {
+      args.push_back(arg);
+    }
+  }
+  if (args.empty() || (verify && !stream)) {
+    usage();
+    return 2;
+  }
+
+  std::vector<fs::path> inputs;
+  if (!collect_inputs(args, &inputs)) {
+    return 1;
+  }
+  std::error_code ec;
+  fs::create_directories(output_dir, ec);
+  if (ec) {
+    std::cerr << "material_batch: unable to create " << output_dir.string()
+              << ": " << ec.message() << "\n";
+    return 1;
+  }
+
+  std::vector<job> jobs(inputs.size());
+  std::vector<std::size_t> queue(inputs.size());
+  for (std::size_t i = 0; i < inputs.size(); ++i) {
+    jobs[i].input = inputs[i];
+    jobs[i].size = fs::file_size(inputs[i], ec);
+    jobs[i].ok = false;
+    queue[i] = i;
+  }
+  // largest files first, the small ones fill the gaps at the end.
+  std::stable_sort(queue.begin(), queue.end(),
+      [&jobs](std::size_t a, std::size_t b) {
+        return jobs[a].size > jobs[b].size;
+      });
+
+  unsigned num_workers = static_cast<unsigned>(std::min<std::size_t>(
+      num_threads, std::max<std::size_t>(1, jobs.size())));
+  unsigned build_threads = num_threads / num_workers;
+  std::atomic<std::size_t> next(0);
+  auto worker = [&]() {
+    if (stream) {
+      StreamingClassifier classifier;
+      classifier.set_verify(verify);
+      for (std::size_t i = next++; i < queue.size(); i = next++) {
+        classify_stream(output_dir, &classifier, &jobs[queue[i]]);
+      }
+      return;
+    }
+    LayoutClassifier layout;
+    layout.set_nesting_engine(engine);
+    layout.set_threads(build_threads);
+    for (std::size_t i = next++; i < queue.size(); i = next++) {
+      classify(output_dir, &layout, &jobs[queue[i]]);
+    }
+  };
+  std::vector<std::thread> workers;
+  for (unsigned t = 1; t < num_workers; ++t) {
+    workers.emplace_back(worker);
+  }
+  worker();
+  for (auto& w : workers) {
+    w.join();
+  }
+
+  int failures = 0;
+  for (const auto& j : jobs) {
+    (j.ok ? std::cout : std::cerr) << j.report << "\n";
+    failures += j.ok ? 0 : 1;
+  }
+  return failures == 0 ? 0 : 1;
+}
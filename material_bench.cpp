@@ -0,0 +1,540 @@
+// Benchmarks the classification pipeline stage by stage and reports the
+// timings as JSON, so runs can be compared across changes and engines.
+//
+// usage: material_bench [-r repetitions] [--engine sweep|voronoi|both]
+//                       [--voronoi] [--scale n]... [-o report.json]
+//                       [--threads n] [--trace trace.json] <directory>...
+//
+// Every directory is a group of inputs, its *.txt and *.msop files. Each
+// file is read, built and prepared for drawing -r times (default 3) with one
+// LayoutClassifier per group, as material_batch does. The stages are timed
+// separately:
+//
+//   read               LayoutClassifier::read_data
+//   construct_voronoi  the voronoi diagram, for the voronoi engine or with
+//   color_exterior     --voronoi, which builds it like the visualizer does
+//                      when showing it
+//   contours           the contour arena
+//   nesting            parents and depths of the contours
+//   regions            combined_polygon_set
+//   triangulate        ear clipping of the regions like
+//                      GLWidget::triangulate_fill, the part of the drawing
+//                      preparation that needs no Qt
+//   total              all of the above
+//
+// For every group, engine and stage the report has the number of samples,
+// the total, mean, 50th, 90th and 99th percentile and maximum time in
+// milliseconds, and the mean number and size of heap allocations per
+// sample, counted by replacing the global operator new. The layout of a
+// group is reused from file to file, so after the first repetition these
+// show what a build allocates beyond the capacity kept from the last one.
+// Every group also reports the most memory its layout held after a build.
+//
+// --scale n adds a group per directory in which every input is tiled n by
+// n times side by side. The tiled layouts are written in the binary format
+// to a temporary directory of the run's own, read back from there and
+// removed at the end. Inputs whose tiling would leave the 32-bit coordinate
+// range are skipped.
+//
+// --threads n lets every build split its layout over n threads, 0 for one
+// per core, see LayoutClassifier::set_threads(). The default is 1.
+//
+// --trace enables the Tracer for the whole run and writes its spans and
+// counters as a Chrome trace, which adds a little to every stage timed.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <new>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "LayoutClassifier.h"
+#include "LayoutFormat.h"
+#include "Tracer.h"
+#include "ear_triangulation.hpp"
+#include "percentile.hpp"
+#include "point_in_contour.hpp"
+
+namespace fs = std::filesystem;
+
+namespace {
+
+std::atomic<std::size_t> num_allocations(0);
+std::atomic<std::size_t> num_allocated_bytes(0);
+
+}  // namespace
+
+// Every allocation of the process goes through here, including those of the
+// standard library. Aligned allocations are left alone.
+void* operator new(std::size_t size) {
+  num_allocations.fetch_add(1, std::memory_order_relaxed);
+  num_allocated_bytes.fetch_add(size, std::memory_order_relaxed);
+  if (void* p = std::malloc(size == 0 ? 1 : size)) {
+    return p;
+  }
+  throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept {
+  std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept {
+  std::free(p);
+}
+
+namespace {
+
+const char* const STAGES[] = {
+  "read", "construct_voronoi", "color_exterior", "contours", "nesting",
+  "regions", "triangulate", "total"
+};
+
+void usage() {
+  std::cerr << "usage: material_bench [-r repetitions] "
+               "[--engine sweep|voronoi|both] [--voronoi] [--scale n]... "
+               "[-o report.json] [--threads n] [--trace trace.json] "
+               "<directory>...\n";
+}
+
+// Time and allocation counts at some point, stages are the difference of
+// two of them.
+struct snapshot {
+  std::chrono::steady_clock::time_point time;
+  std::size_t allocations;
+  std::size_t bytes;
+
+  static snapshot now() {
+    snapshot s;
+    s.allocations = num_allocations.load(std::memory_order_relaxed);
+    s.bytes = num_allocated_bytes.load(std::memory_order_relaxed);
+    s.time = std::chrono::steady_clock::now();
+    return s;
+  }
+};
+
+struct stage_samples {
+  stage_samples() : allocations(0), bytes(0) {}
+
+  std::vector<double> ms;
+  std::size_t allocations;
+  std::size_t bytes;
+
+  void add(const snapshot& since) {
+    snapshot until = snapshot::now();
+    ms.push_back(std::chrono::duration<double, std::milli>(
+        until.time - since.time).count());
+    allocations += until.allocations - since.allocations;
+    bytes += until.bytes - since.bytes;
+  }
+};
+
+typedef std::map<std::string, stage_samples> stage_map;
+
+// Times the stages of LayoutClassifier::build().
+class stage_recorder : public LayoutClassifier::stage_listener {
+ public:
+  explicit stage_recorder(stage_map* stages) : stages_(stages) {}
+
+  void begin_stage(const char*) override { begin_ = snapshot::now(); }
+  void end_stage(const char* name) override { (*stages_)[name].add(begin_); }
+
+ private:
+  stage_map* stages_;
+  snapshot begin_;
+};
+
+struct group {
+  std::string name;
+  std::vector<fs::path> inputs;
+};
+
+struct group_result {
+  group_result()
+      : files(0),
+        errors(0),
+        contours(0),
+        segments(0),
+        regions(0),
+        peak_memory_bytes(0) {}
+
+  std::string group;
+  std::string engine;
+  std::size_t files;
+  std::size_t errors;
+  // of a single repetition.
+  std::size_t contours;
+  std::size_t segments;
+  std::size_t regions;
+  // LayoutClassifier::peak_memory_bytes() of the group.
+  std::size_t peak_memory_bytes;
+  stage_map stages;
+};
+
+std::vector<fs::path> list_inputs(const fs::path& directory) {
+  std::vector<fs::path> files;
+  std::error_code ec;
+  for (const auto& entry : fs::directory_iterator(directory, ec)) {
+    fs::path extension = entry.path().extension();
+    if (entry.is_regular_file() &&
+        (extension == ".txt" || extension == LAYOUT_EXTENSION)) {
+      files.push_back(entry.path());
+    }
+  }
+  std::sort(files.begin(), files.end());
+  return files;
+}
+
+// Writes source tiled n by n times to path. The closed contours of all
+// tiles come first, so the chains that do not close cannot swallow them.
+bool write_tiled(const LayoutClassifier& source, int n, const fs::path& path,
+                 std::string* error) {
+  const rect_type& brect = source.brect();
+  std::int64_t step_x = static_cast<std::int64_t>(xh(brect)) - xl(brect) + 1;
+  std::int64_t step_y = static_cast<std::int64_t>(yh(brect)) - yl(brect) + 1;
+  if (xl(brect) + step_x * n - 1 > INT32_MAX ||
+      yl(brect) + step_y * n - 1 > INT32_MAX) {
+    *error = "tiling leaves the coordinate range";
+    return false;
+  }
+  const std::vector<segment_type>& segments = source.segment_data();
+  const std::vector<int>& contour_end = source.contour_end();
+  std::size_t closed = contour_end.empty() ? 0 : contour_end.back() + 1;
+  LayoutClassifier tiled;
+  tiled.reserve_points(source.point_data().size() * n * n);
+  tiled.reserve_segments(segments.size() * n * n);
+  auto add = [&tiled, &segments](std::size_t begin, std::size_t end,
+                                 int dx, int dy) {
+    for (std::size_t i = begin; i < end; ++i) {
+      tiled.add_segment(low(segments[i]).x() + dx, low(segments[i]).y() + dy,
+                        high(segments[i]).x() + dx,
+                        high(segments[i]).y() + dy);
+    }
+  };
+  for (int tile = 0; tile < n * n; ++tile) {
+    int dx = static_cast<int>(step_x * (tile % n));
+    int dy = static_cast<int>(step_y * (tile / n));
+    for (const auto& p : source.point_data()) {
+      tiled.add_point(p.x() + dx, p.y() + dy);
+    }
+    add(0, closed, dx, dy);
+  }
+  for (int tile = 0; tile < n * n; ++tile) {
+    add(closed, segments.size(), static_cast<int>(step_x * (tile % n)),
+        static_cast<int>(step_y * (tile / n)));
+  }
+  return tiled.write_binary(path.string(), error);
+}
+
+// Creates a new directory below the temporary directory, which no other run
+// uses at the same time. Returns an empty path if it cannot.
+fs::path make_scratch_directory() {
+  std::error_code ec;
+  fs::path temp = fs::temp_directory_path(ec);
+  if (ec) {
+    return fs::path();
+  }
+  std::random_device seed;
+  std::mt19937_64 random(
+      (static_cast<std::uint64_t>(seed()) << 32) ^ seed() ^
+      static_cast<std::uint64_t>(
+          std::chrono::steady_clock::now().time_since_epoch().count()));
+  for (int attempt = 0; attempt < 100; ++attempt) {
+    fs::path path = temp / ("material_bench-" + std::to_string(random()));
+    // fails if the directory exists already.
+    if (fs::create_directory(path, ec)) {
+      return path;
+    }
+  }
+  return fs::path();
+}
+
+// Tiles every input of source into directory, as a group of its own.
+group scale_group(const group& source, int n, const fs::path& directory) {
+  group scaled;
+  scaled.name = source.name + "@" + std::to_string(n) + "x" +
+                std::to_string(n);
+  fs::path target = directory / scaled.name;
+  std::error_code ec;
+  fs::create_directories(target, ec);
+  LayoutClassifier layout;
+  for (const auto& input : source.inputs) {
+    std::string error;
+    layout.clear();
+    fs::path output = target / input.filename();
+    output.replace_extension(LAYOUT_EXTENSION);
+    if (layout.read_data(input.string(), &error) && !layout.empty() &&
+        write_tiled(layout, n, output, &error)) {
+      scaled.inputs.push_back(output);
+    } else if (!error.empty()) {
+      std::cerr << "material_bench: skipping " << input.string() << " at "
+                << n << "x" << n << ": " << error << "\n";
+    }
+  }
+  return scaled;
+}
+
+// Triangulates the regions of layout like GLWidget::triangulate_fill.
+std::size_t triangulate(const LayoutClassifier& layout,
+                        std::vector<float>* vertices) {
+  std::vector<std::vector<point_type>> rings;
+  std::vector<point_type> triangles;
+  vertices->clear();
+  for (const auto& region : layout.combined_polygon_set()) {
+    rings.resize(1);
+    rings[0].assign(region.begin(), region.end());
+    for (auto it = region.begin_holes(); it != region.end_holes(); ++it) {
+      rings.push_back(std::vector<point_type>(it->begin(), it->end()));
+    }
+    triangles.clear();
+    ear_triangulation<point_type>::run(rings, &triangles);
+    for (const auto& vertex : triangles) {
+      vertices->push_back(vertex.x());
+      vertices->push_back(vertex.y());
+    }
+  }
+  return vertices->size() / 6;
+}
+
+group_result run_group(const group& g, LayoutClassifier::nesting_engine engine,
+                       bool with_voronoi, unsigned threads, int repetitions) {
+  group_result result;
+  result.group = g.name;
+  result.engine =
+      engine == LayoutClassifier::VORONOI_NESTING ? "voronoi" : "sweep";
+  result.files = g.inputs.size();
+  stage_recorder recorder(&result.stages);
+  LayoutClassifier layout;
+  layout.set_nesting_engine(engine);
+  layout.set_threads(threads);
+  layout.set_stage_listener(&recorder);
+  std::vector<float> vertices;
+  for (int r = 0; r < repetitions; ++r) {
+    for (const auto& input : g.inputs) {
+      std::string error;
+      snapshot begin = snapshot::now();
+      layout.clear();
+      snapshot read = snapshot::now();
+      if (!layout.read_data(input.string(), &error)) {
+        if (r == 0) {
+          std::cerr << "material_bench: " << error << "\n";
+          ++result.errors;
+        }
+        continue;
+      }
+      result.stages["read"].add(read);
+      if (with_voronoi) {
+        layout.build_voronoi();
+      }
+      layout.build();
+      snapshot prepare = snapshot::now();
+      triangulate(layout, &vertices);
+      result.stages["triangulate"].add(prepare);
+      result.stages["total"].add(begin);
+      if (r == 0) {
+        result.contours += layout.contours().size();
+        result.segments += layout.segment_data().size();
+        result.regions += layout.combined_polygon_set().size();
+      }
+    }
+  }
+  result.peak_memory_bytes = layout.peak_memory_bytes();
+  return result;
+}
+
+std::string quoted(const std::string& text) {
+  std::string out("\"");
+  for (char c : text) {
+    if (c == '"' || c == '\\') {
+      out += '\\';
+      out += c;
+    } else if (static_cast<unsigned char>(c) < 0x20) {
+      char escaped[8];
+      std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+      out += escaped;
+    } else {
+      out += c;
+    }
+  }
+  return out + "\"";
+}
+
+void write_report(const std::vector<group_result>& results, int repetitions,
+                  unsigned threads, std::ostream& out) {
+  out << "{\n  \"repetitions\": " << repetitions
+      << ",\n  \"threads\": " << threads
+      << ",\n  \"avx2\": "
+      << (point_in_contour::has_avx2() ? "true" : "false")
+      << ",\n  \"results\": [";
+  for (std::size_t i = 0; i < results.size(); ++i) {
+    const group_result& result = results[i];
+    out << (i == 0 ? "\n" : ",\n")
+        << "    {\n      \"group\": " << quoted(result.group)
+        << ",\n      \"engine\": " << quoted(result.engine)
+        << ",\n      \"files\": " << result.files
+        << ",\n      \"errors\": " << result.errors
+        << ",\n      \"contours\": " << result.contours
+        << ",\n      \"segments\": " << result.segments
+        << ",\n      \"regions\": " << result.regions
+        << ",\n      \"peak_memory_bytes\": " << result.peak_memory_bytes
+        << ",\n      \"stages\": [";
+    bool first = true;
+    for (const char* name : STAGES) {
+      auto it = result.stages.find(name);
+      if (it == result.stages.end() || it->second.ms.empty()) {
+        continue;
+      }
+      std::vector<double> sorted(it->second.ms);
+      std::sort(sorted.begin(), sorted.end());
+      double total = 0;
+      for (double ms : sorted) {
+        total += ms;
+      }
+      double n = static_cast<double>(sorted.size());
+      out << (first ? "\n" : ",\n")
+          << "        {\"name\": " << quoted(name)
+          << ", \"samples\": " << sorted.size()
+          << ", \"total_ms\": " << total
+          << ", \"mean_ms\": " << total / n
+          << ", \"p50_ms\": " << percentile(sorted, 50)
+          << ", \"p90_ms\": " << percentile(sorted, 90)
+          << ", \"p99_ms\": " << percentile(sorted, 99)
+          << ", \"max_ms\": " << sorted.back()
+          << ", \"allocations\": " << it->second.allocations / n
+          << ", \"allocated_bytes\": " << it->second.bytes / n << "}";
+      first = false;
+    }
+    out << "\n      ]\n    }";
+  }
+  out << "\n  ]\n}\n";
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  int repetitions = 3;
+  bool with_voronoi = false;
+  std::vector<LayoutClassifier::nesting_engine> engines(
+      1, LayoutClassifier::SWEEP_NESTING);
+  std::vector<int> scales;
+  std::string report_path;
+  std::string trace_path;
+  unsigned threads = 1;
+  std::vector<std::string> args;
+  for (int i = 1; i < argc; ++i) {
+    std::string arg(argv[i]);
+    if (arg == "-r" && i + 1 < argc) {
+      repetitions = std::max(1, std::atoi(argv[++i]));
+    } else if (arg == "-o" && i + 1 < argc) {
+      report_path = argv[++i];
+    } else if (arg == "--threads" && i + 1 < argc) {
+      threads = static_cast<unsigned>(std::max(0, std::atoi(argv[++i])));
+    } else if (arg == "--trace" && i + 1 < argc) {
+      trace_path = argv[++i];
+    } else if (arg == "--voronoi") {
+      with_voronoi = true;
+    } else if (arg == "--scale" && i + 1 < argc) {
+      int n = std::atoi(argv[++i]);
+      if (n < 1) {
+        usage();
+        return 2;
+      }
+      scales.push_back(n);
+    } else if (arg == "--engine" && i + 1 < argc) {
+      std::string name(argv[++i]);
+      engines.clear();
+      if (name == "sweep" || name == "both") {
+        engines.push_back(LayoutClassifier::SWEEP_NESTING);
+      }
+      if (name == "voronoi" || name == "both") {
+        engines.push_back(LayoutClassifier::VORONOI_NESTING);
+      }
+      if (engines.empty()) {
+        usage();
+        return 2;
+      }
+    } else if (arg == "-h" || arg == "--help") {
+      usage();
+      return 0;
+    } else {
+      args.push_back(arg);
+    }
+  }
+  if (args.empty()) {
+    usage();
+    return 2;
+  }
+
+  std::vector<group> groups;
+  for (const auto& arg : args) {
+    fs::path path(arg);
+    std::error_code ec;
+    if (!fs::is_directory(path, ec)) {
+      std::cerr << "material_bench: no such directory " << arg << "\n";
+      return 1;
+    }
+    group g;
+    g.name = path.filename().empty() ? path.parent_path().filename().string()
+                                     : path.filename().string();
+    g.inputs = list_inputs(path);
+    groups.push_back(g);
+  }
+  fs::path scratch;
+  if (!scales.empty()) {
+    scratch = make_scratch_directory();
+    if (scratch.empty()) {
+      std::cerr << "material_bench: unable to create a temporary directory\n";
+      return 1;
+    }
+    std::size_t num_sources = groups.size();
+    for (int n : scales) {
+      for (std::size_t i = 0; i < num_sources; ++i) {
+        groups.push_back(scale_group(groups[i], n, scratch));
+      }
+    }
+  }
+
+  Tracer::set_enabled(!trace_path.empty());
+  std::vector<group_result> results;
+  for (const auto& g : groups) {
+    for (auto engine : engines) {
+      results.push_back(
+          run_group(g, engine, with_voronoi, threads, repetitions));
+      const group_result& result = results.back();
+      std::cerr << result.group << " (" << result.engine << "): "
+                << result.files << " files, " << result.contours
+                << " contours, " << result.errors << " errors\n";
+    }
+  }
+  if (!scratch.empty()) {
+    std::error_code ec;
+    fs::remove_all(scratch, ec);
+  }
+  std::string error;
+  if (!trace_path.empty() && !Tracer::write_chrome_trace(trace_path, &error)) {
+    std::cerr << "material_bench: " << error << "\n";
+    return 1;
+  }
+
+  if (report_path.empty()) {
+    write_report(results, repetitions, threads, std::cout);
+    return 0;
+  }
+  std::ofstream out(report_path.c_str());
+  write_report(results, repetitions, threads, out);
+  if (!out) {
+    std::cerr << "material_bench: unable to write " << report_path << "\n";
+    return 1;
+  }
+  return 0;
+}
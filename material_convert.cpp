@@ -0,0 +1,108 @@
+// Converts layouts from the text format to the binary format of
+// LayoutFormat.h.
+//
+// usage: material_convert [-o output_dir] <file or directory>...
+//
+// Directories are walked recursively for *.txt files. Every input is written
+// next to itself with the .msop extension, or with -o to the same relative
+// path below output_dir, so a whole tree such as input_data/ can be mirrored.
+
+#include <algorithm>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "LayoutClassifier.h"
+#include "LayoutFormat.h"
+
+namespace fs = std::filesystem;
+
+namespace {
+
+void usage() {
+  std::cerr << "usage: material_convert [-o output_dir] "
+               "<file or directory>...\n";
+}
+
+// Pairs every input file with its output path.
+bool collect_inputs(const std::vector<std::string>& args,
+                    const fs::path& output_dir,
+                    std::vector<std::pair<fs::path, fs::path> >* jobs) {
+  for (const auto& arg : args) {
+    fs::path path(arg);
+    std::error_code ec;
+    std::vector<std::pair<fs::path, fs::path> > found;
+    if (fs::is_directory(path, ec)) {
+      for (const auto& entry : fs::recursive_directory_iterator(path, ec)) {
+        if (!entry.is_regular_file() || entry.path().extension() != ".txt") {
+          continue;
+        }
+        fs::path output = entry.path();
+        if (!output_dir.empty()) {
+          output = output_dir / path.filename() /
+                   fs::relative(entry.path(), path, ec);
+        }
+        found.push_back(std::make_pair(entry.path(), output));
+      }
+      std::sort(found.begin(), found.end());
+    } else if (fs::is_regular_file(path, ec)) {
+      fs::path output = output_dir.empty() ? path
+                                           : output_dir / path.filename();
+      found.push_back(std::make_pair(path, output));
+    } else {
+      std::cerr << "material_convert: no such file or directory " << arg
+                << "\n";
+      return false;
+    }
+    for (auto& job : found) {
+      job.second.replace_extension(LAYOUT_EXTENSION);
+    }
+    jobs->insert(jobs->end(), found.begin(), found.end());
+  }
+  return true;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  fs::path output_dir;
+  std::vector<std::string> args;
+  for (int i = 1; i < argc; ++i) {
+    std::string arg(argv[i]);
+    if (arg == "-o" && i + 1 < argc) {
+      output_dir = argv[++i];
+    } else if (arg == "-h" || arg == "--help") {
+      usage();
+      return 0;
+    } else {
+      args.push_back(arg);
+    }
+  }
+  if (args.empty()) {
+    usage();
+    return 2;
+  }
+
+  std::vector<std::pair<fs::path, fs::path> > jobs;
+  if (!collect_inputs(args, output_dir, &jobs)) {
+    return 1;
+  }
+
+  int failures = 0;
+  LayoutClassifier layout;
+  for (const auto& job : jobs) {
+    std::string error;
+    std::error_code ec;
+    layout.clear();
+    fs::create_directories(job.second.parent_path(), ec);
+    if (!layout.read_data(job.first.string(), &error) ||
+        !layout.write_binary(job.second.string(), &error)) {
+      std::cerr << "material_convert: " << error << "\n";
+      ++failures;
+      continue;
+    }
+    std::cout << job.first.string() << " -> " << job.second.string() << "\n";
+  }
+  return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,473 @@
+// Generates layouts of nested contours whose classification is known, to
+// stress and validate the classifier at scale, and checks the classifier
+// against them.
+//
+// usage: material_generate [-n contours] [-d depth] [-b branching]
+//                          [-v vertices] [--shape star|rect] [--touching]
+//                          [--seed s] -o layout.txt
+//        material_generate --check [--engine sweep|voronoi] [--threads n]
+//                          <layout.txt>...
+//
+// A layout is a grid of islands, each a tree of contours: a contour at depth
+// below -d (default 3) holds -b (default 4) children side by side, so the
+// contours at even depth bound material and those at odd depth bound its
+// holes. Islands are added until there are -n contours (default 1000), the
+// last one may be partial. Every contour has -v vertices (default 8) and a
+// random orientation.
+//
+// --shape star (the default) draws every contour as a star-shaped polygon
+// with random radii. --shape rect draws axis-aligned rectangles with the
+// vertices beyond the corners spread along their edges, so consecutive
+// edges are collinear, and siblings in a row share the lines of their
+// horizontal edges. --touching makes neighbouring siblings and islands
+// touch at a vertex; star contours then need a multiple of 4 vertices.
+//
+// The layout is written in the text format, and the depth of every contour,
+// one per line in file order, to the same path with the .depth extension.
+// --check builds each given layout with LayoutClassifier and compares its
+// contour depths with that file. --threads n builds it on n threads, see
+// LayoutClassifier::set_threads(), and reports the groups it was split
+// into; the default is 1.
+
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "LayoutClassifier.h"
+
+namespace fs = std::filesystem;
+
+namespace {
+
+const double PI = 3.14159265358979323846;
+
+void usage() {
+  std::cerr << "usage: material_generate [-n contours] [-d depth] "
+               "[-b branching] [-v vertices] [--shape star|rect] "
+               "[--touching] [--seed s] -o layout.txt\n"
+               "       material_generate --check [--engine sweep|voronoi] "
+               "[--threads n] <layout.txt>...\n";
+}
+
+struct options {
+  options()
+      : contours(1000), depth(3), branching(4), vertices(8), rect(false),
+        touching(false), seed(1) {}
+
+  std::int64_t contours;
+  int depth;
+  int branching;
+  int vertices;
+  bool rect;
+  bool touching;
+  unsigned seed;
+};
+
+// Appends text through a large buffer, ofstream alone is slow on millions of
+// small writes.
+class text_writer {
+ public:
+  explicit text_writer(std::ofstream* out) : out_(out) {
+    buffer_.reserve(BUFFER_SIZE + 64);
+  }
+  ~text_writer() { flush(); }
+
+  void number(std::int64_t value, char separator) {
+    char text[24];
+    char* end = std::to_chars(text, text + sizeof(text), value).ptr;
+    buffer_.append(text, end);
+    buffer_ += separator;
+    if (buffer_.size() >= BUFFER_SIZE) {
+      flush();
+    }
+  }
+
+  void flush() {
+    out_->write(buffer_.data(), buffer_.size());
+    buffer_.clear();
+  }
+
+ private:
+  static const std::size_t BUFFER_SIZE = 1 << 20;
+
+  std::ofstream* out_;
+  std::string buffer_;
+};
+
+class layout_generator {
+ public:
+  explicit layout_generator(const options& opts)
+      : opts_(opts), rng_(opts.seed), grid_(1), emitted_(0) {
+    while (grid_ * grid_ < opts_.branching) {
+      ++grid_;
+    }
+  }
+
+  // Picks the size of the contours at every depth, the smallest that keeps
+  // the deepest ones drawable, and lays out the islands. Fails if they do
+  // not fit the 32-bit coordinate range.
+  bool plan(std::string* error) {
+    std::int64_t leaf = opts_.rect ? std::max(16, 8 * opts_.vertices)
+                                   : std::max(16, 5 * opts_.vertices);
+    std::int64_t side = leaf + (leaf & 1);
+    // the layout is centered on the origin.
+    const std::int64_t limit = (std::int64_t(1) << 32) - 2;
+    while (true) {
+      sides_.assign(1, side);
+      while (static_cast<int>(sides_.size()) < opts_.depth &&
+             sides_.back() >= leaf) {
+        sides_.push_back(child_side(sides_.back()));
+      }
+      if (sides_.back() >= leaf) {
+        break;
+      }
+      side *= 2;
+      if (side >= limit) {
+        *error = "the depth does not fit the coordinate range";
+        return false;
+      }
+    }
+    // contours per island, capped at what is asked for.
+    std::int64_t per_island = 0;
+    std::int64_t level = 1;
+    for (int d = 0; d < opts_.depth && per_island < opts_.contours; ++d) {
+      per_island += level;
+      level = std::min(level * opts_.branching, opts_.contours);
+    }
+    std::int64_t islands = (opts_.contours + per_island - 1) / per_island;
+    columns_ = 1;
+    while (columns_ * columns_ < islands) {
+      ++columns_;
+    }
+    pitch_ = opts_.touching ? side : side + side / 8;
+    std::int64_t extent = columns_ * pitch_;
+    if (extent >= limit) {
+      *error = "the contours do not fit the coordinate range";
+      return false;
+    }
+    origin_ = -extent / 2;
+    islands_ = islands;
+    return true;
+  }
+
+  bool write(const fs::path& path, std::string* error) {
+    fs::path truth_path(path);
+    truth_path.replace_extension(".depth");
+    std::ofstream out(path.string().c_str(), std::ios::binary);
+    std::ofstream truth_out(truth_path.string().c_str(), std::ios::binary);
+    if (!out || !truth_out) {
+      *error = "Unable to open file " + (!out ? path : truth_path).string();
+      return false;
+    }
+    {
+      text_writer layout(&out);
+      text_writer truth(&truth_out);
+      layout.number(0, '\n');
+      layout.number(opts_.contours * opts_.vertices, '\n');
+      for (std::int64_t i = 0; i < islands_; ++i) {
+        emit(origin_ + (i % columns_) * pitch_,
+             origin_ + (i / columns_) * pitch_, 0, i % columns_,
+             &layout, &truth);
+      }
+    }
+    if (!out || !truth_out) {
+      *error = "Unable to write file " + (!out ? path : truth_path).string();
+      return false;
+    }
+    return true;
+  }
+
+  std::int64_t extent() const { return columns_ * pitch_; }
+
+ private:
+  struct vertex {
+    std::int64_t x, y;
+  };
+
+  // Star contours keep their vertices between inner_radius() and
+  // outer_radius() of the center of their box, or on the middle of its
+  // sides when touching.
+  double inner_radius(std::int64_t side) const { return 0.4 * side; }
+  double outer_radius(std::int64_t side) const { return 0.475 * side; }
+
+  // Angular jitter as a fraction of half the angle between vertices.
+  double jitter() const { return opts_.vertices >= 8 ? 0.3 : 0.0; }
+
+  // Side of the square the children are laid out in, inside a contour of
+  // the given box side.
+  std::int64_t children_square(std::int64_t side, std::int64_t width,
+                               std::int64_t height) const {
+    if (opts_.rect) {
+      return static_cast<std::int64_t>(0.8 * std::min(width, height));
+    }
+    // the edges of a star stay this far from its center, the corners of the
+    // square must too.
+    double reach = inner_radius(side) *
+                   std::cos(PI / opts_.vertices * (1 + jitter())) * 0.95;
+    return static_cast<std::int64_t>(reach * std::sqrt(2.0));
+  }
+
+  // Width and height of the rectangle drawn in a box.
+  void rect_size(std::int64_t side, std::int64_t* width,
+                 std::int64_t* height) const {
+    if (opts_.touching) {
+      *width = side;
+      *height = side / 2;
+    } else {
+      *width = *height = side - 2 * (side / 16);
+    }
+  }
+
+  std::int64_t child_side(std::int64_t side) const {
+    std::int64_t width = side, height = side;
+    if (opts_.rect) {
+      rect_size(side, &width, &height);
+    }
+    std::int64_t child = children_square(side, width, height) / grid_;
+    return child - (child & 1);
+  }
+
+  // Writes the contour in the box of the given corner and the sides_[depth]
+  // side, then its children. column decides which half of the box a
+  // touching rectangle takes.
+  void emit(std::int64_t x0, std::int64_t y0, int depth, std::int64_t column,
+            text_writer* layout, text_writer* truth) {
+    if (emitted_ == opts_.contours) {
+      return;
+    }
+    ++emitted_;
+    const std::int64_t side = sides_[depth];
+    std::int64_t cx = x0 + side / 2;
+    std::int64_t cy = y0 + side / 2;
+    std::int64_t width = side, height = side;
+    if (opts_.rect) {
+      rect_size(side, &width, &height);
+      std::int64_t xl = x0 + (side - width) / 2;
+      std::int64_t yl = y0 + (side - height) / 2;
+      if (opts_.touching) {
+        // alternate halves, neighbours then share a corner.
+        yl = (column % 2 == 0) ? y0 + side - height : y0;
+      }
+      rect_vertices(xl, yl, width, height);
+      cx = xl + width / 2;
+      cy = yl + height / 2;
+    } else {
+      star_vertices(cx, cy, side);
+    }
+    if (rng_() & 1) {
+      std::reverse(vertices_.begin(), vertices_.end());
+    }
+    for (std::size_t i = 0; i < vertices_.size(); ++i) {
+      const vertex& a = vertices_[i];
+      const vertex& b = vertices_[(i + 1) % vertices_.size()];
+      layout->number(a.x, ' ');
+      layout->number(a.y, ' ');
+      layout->number(b.x, ' ');
+      layout->number(b.y, '\n');
+    }
+    truth->number(depth, '\n');
+
+    if (depth + 1 == static_cast<int>(sides_.size())) {
+      return;
+    }
+    const std::int64_t child = sides_[depth + 1];
+    std::int64_t left = cx - grid_ * child / 2;
+    std::int64_t bottom = cy - grid_ * child / 2;
+    for (int i = 0; i < opts_.branching; ++i) {
+      emit(left + (i % grid_) * child, bottom + (i / grid_) * child,
+           depth + 1, i % grid_, layout, truth);
+    }
+  }
+
+  void star_vertices(std::int64_t cx, std::int64_t cy, std::int64_t side) {
+    const int n = opts_.vertices;
+    std::uniform_real_distribution<double> radius(inner_radius(side),
+                                                  outer_radius(side));
+    std::uniform_real_distribution<double> shift(-jitter(), jitter());
+    vertices_.clear();
+    for (int k = 0; k < n; ++k) {
+      vertex v;
+      if (opts_.touching && k % (n / 4) == 0) {
+        // on the middle of a side, where the neighbour has one too.
+        static const int DX[] = {1, 0, -1, 0};
+        static const int DY[] = {0, 1, 0, -1};
+        v.x = cx + DX[k / (n / 4)] * side / 2;
+        v.y = cy + DY[k / (n / 4)] * side / 2;
+      } else {
+        double angle = (2 * k + shift(rng_)) * PI / n;
+        double r = radius(rng_);
+        v.x = cx + std::llround(r * std::cos(angle));
+        v.y = cy + std::llround(r * std::sin(angle));
+      }
+      vertices_.push_back(v);
+    }
+  }
+
+  void rect_vertices(std::int64_t xl, std::int64_t yl, std::int64_t width,
+                     std::int64_t height) {
+    const vertex corners[] = {
+      {xl, yl}, {xl + width, yl}, {xl + width, yl + height},
+      {xl, yl + height}
+    };
+    const int extra = opts_.vertices - 4;
+    vertices_.clear();
+    for (int e = 0; e < 4; ++e) {
+      const vertex& a = corners[e];
+      const vertex& b = corners[(e + 1) % 4];
+      int count = extra / 4 + (e < extra % 4 ? 1 : 0);
+      vertices_.push_back(a);
+      for (int k = 1; k <= count; ++k) {
+        vertex v = {a.x + (b.x - a.x) * k / (count + 1),
+                    a.y + (b.y - a.y) * k / (count + 1)};
+        vertices_.push_back(v);
+      }
+    }
+  }
+
+  options opts_;
+  std::mt19937 rng_;
+  // children are laid out on a grid_ by grid_ square.
+  int grid_;
+  // box side of the contours at every depth.
+  std::vector<std::int64_t> sides_;
+  std::int64_t islands_;
+  std::int64_t columns_;
+  std::int64_t pitch_;
+  std::int64_t origin_;
+  std::int64_t emitted_;
+  std::vector<vertex> vertices_;
+};
+
+bool check(const std::string& path, LayoutClassifier::nesting_engine engine,
+           unsigned threads, std::string* report) {
+  LayoutClassifier layout;
+  layout.set_nesting_engine(engine);
+  layout.set_threads(threads);
+  std::string error;
+  if (!layout.read_data(path, &error)) {
+    *report = "material_generate: " + error;
+    return false;
+  }
+  layout.build();
+  fs::path truth_path(path);
+  truth_path.replace_extension(".depth");
+  std::ifstream truth(truth_path.string().c_str());
+  if (!truth) {
+    *report = "material_generate: Unable to open file " + truth_path.string();
+    return false;
+  }
+  std::vector<int> expected;
+  int depth;
+  while (truth >> depth) {
+    expected.push_back(depth);
+  }
+  const std::vector<int>& found = layout.contour_depth();
+  std::size_t mismatches = 0;
+  for (std::size_t i = 0; i < std::min(found.size(), expected.size()); ++i) {
+    mismatches += found[i] != expected[i];
+  }
+  *report = path + ": " + std::to_string(found.size()) + " contours, " +
+            std::to_string(mismatches) + " with a wrong depth";
+  if (found.size() != expected.size()) {
+    *report += ", " + std::to_string(expected.size()) + " expected";
+  }
+  if (threads != 1) {
+    *report += ", " + std::to_string(layout.num_groups()) + " groups";
+  }
+  return mismatches == 0 && found.size() == expected.size();
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  options opts;
+  bool check_mode = false;
+  LayoutClassifier::nesting_engine engine = LayoutClassifier::SWEEP_NESTING;
+  unsigned threads = 1;
+  std::string output;
+  std::vector<std::string> args;
+  for (int i = 1; i < argc; ++i) {
+    std::string arg(argv[i]);
+    if (arg == "-n" && i + 1 < argc) {
+      opts.contours = std::atoll(argv[++i]);
+    } else if (arg == "-d" && i + 1 < argc) {
+      opts.depth = std::atoi(argv[++i]);
+    } else if (arg == "-b" && i + 1 < argc) {
+      opts.branching = std::atoi(argv[++i]);
+    } else if (arg == "-v" && i + 1 < argc) {
+      opts.vertices = std::atoi(argv[++i]);
+    } else if (arg == "--shape" && i + 1 < argc) {
+      std::string name(argv[++i]);
+      if (name != "star" && name != "rect") {
+        usage();
+        return 2;
+      }
+      opts.rect = name == "rect";
+    } else if (arg == "--touching") {
+      opts.touching = true;
+    } else if (arg == "--seed" && i + 1 < argc) {
+      opts.seed = static_cast<unsigned>(std::strtoul(argv[++i], NULL, 10));
+    } else if (arg == "-o" && i + 1 < argc) {
+      output = argv[++i];
+    } else if (arg == "--check") {
+      check_mode = true;
+    } else if (arg == "--threads" && i + 1 < argc) {
+      threads = static_cast<unsigned>(std::max(0, std::atoi(argv[++i])));
+    } else if (arg == "--engine" && i + 1 < argc) {
+      std::string name(argv[++i]);
+      if (name == "sweep") {
+        engine = LayoutClassifier::SWEEP_NESTING;
+      } else if (name == "voronoi") {
+        engine = LayoutClassifier::VORONOI_NESTING;
+      } else {
+        usage();
+        return 2;
+      }
+    } else if (arg == "-h" || arg == "--help") {
+      usage();
+      return 0;
+    } else {
+      args.push_back(arg);
+    }
+  }
+
+  if (check_mode) {
+    if (args.empty()) {
+      usage();
+      return 2;
+    }
+    bool ok = true;
+    for (const auto& path : args) {
+      std::string report;
+      ok = check(path, engine, threads, &report) && ok;
+      std::cout << report << "\n";
+    }
+    return ok ? 0 : 1;
+  }
+
+  if (output.empty() || !args.empty() || opts.contours < 1 ||
+      opts.depth < 1 || opts.branching < 1 || opts.vertices < 3 ||
+      (opts.rect && opts.vertices < 4) ||
+      (opts.touching && !opts.rect && opts.vertices % 4 != 0)) {
+    usage();
+    return 2;
+  }
+  layout_generator generator(opts);
+  std::string error;
+  if (!generator.plan(&error) || !generator.write(output, &error)) {
+    std::cerr << "material_generate: " << error << "\n";
+    return 1;
+  }
+  std::cout << output << ": " << opts.contours << " contours, "
+            << opts.contours * opts.vertices << " segments, "
+            << generator.extent() << " wide\n";
+  return 0;
+}
@@ -0,0 +1,229 @@
+#ifndef NESTING_SWEEP_HPP
+#define NESTING_SWEEP_HPP
+
+#include <algorithm>
+#include <climits>
+#include <cstdint>
+#include <set>
+#include <vector>
+
+#include "contour_arena.hpp"
+#include "exact_predicates.hpp"
+#include "node_pool.hpp"
+
+// Plane sweep assigning every closed contour its parent and nesting depth.
+//
+// Contours are read from a contour_arena, which also provides their
+// orientation. Contours are assumed not to intersect each other, so the
+// order of the segments crossing a vertical line never changes while they
+// are active.
+//
+// The sweep moves from left to right. When it reaches the leftmost vertex of
+// a contour, the nearest active segment below that vertex decides the
+// nesting: if the interior of the owning contour lies above the segment, the
+// owner is the parent, otherwise the owner is a sibling and shares its
+// parent. All predicates use exact integer arithmetic, so coordinates must be
+// integral and fit into 32 bits.
+//
+// A sweep keeps its buffers and the nodes of its status from run to run, so
+// running it again over a layout of similar size does not allocate.
+class nesting_sweep {
+ public:
+  void run(const contour_arena& contours,
+           std::vector<int>* parent,
+           std::vector<int>* depth) {
+    collect(contours);
+    sweep();
+    // the vectors given are reused for the next run.
+    parent->swap(parent_);
+    depth->swap(depth_);
+  }
+
+  // Bytes held for the next run.
+  std::size_t capacity_bytes() const {
+    return segments_.capacity() * sizeof(sweep_segment) +
+           events_.capacity() * sizeof(event) +
+           leftmost_.capacity() * sizeof(vertex) +
+           (area_sign_.capacity() + parent_.capacity() + depth_.capacity()) *
+               sizeof(int) +
+           position_.capacity() * sizeof(status_type::iterator) +
+           pool_.capacity_bytes();
+  }
+
+ private:
+  typedef long long int64;
+
+  struct vertex {
+    int64 x, y;
+    bool operator<(const vertex& that) const {
+      return x != that.x ? x < that.x : y < that.y;
+    }
+  };
+
+  struct sweep_segment {
+    vertex left, right;
+    // contour owning the segment.
+    int contour;
+    // true if the contour runs from left to right along this segment.
+    bool forward;
+    // unique id breaking ties between collinear segments.
+    int id;
+  };
+
+  // Sign of the cross product (b - a) x (c - a).
+  static int orientation(const vertex& a, const vertex& b, const vertex& c) {
+    return cross_sign(b.x - a.x, b.y - a.y, c.x - a.x, c.y - a.y);
+  }
+
+  // Orders segments that are active at the same time from bottom to top.
+  struct below {
+    bool operator()(const sweep_segment* s, const sweep_segment* t) const {
+      if (s->id == t->id) {
+        return false;
+      }
+      if (s->left.x <= t->left.x) {
+        int o = orientation(s->left, s->right, t->left);
+        if (o == 0) {
+          o = orientation(s->left, s->right, t->right);
+        }
+        return o == 0 ? s->id < t->id : o > 0;
+      }
+      int o = orientation(t->left, t->right, s->left);
+      if (o == 0) {
+        o = orientation(t->left, t->right, s->right);
+      }
+      return o == 0 ? s->id < t->id : o < 0;
+    }
+  };
+
+  typedef std::set<const sweep_segment*, below,
+                   pool_allocator<const sweep_segment*> > status_type;
+
+  // At equal x, segments ending there leave the status before segments
+  // starting there enter, and only then the contours starting there are
+  // located. A query therefore sees the segments with left.x <= x < right.x,
+  // which counts a contour passing through x at a vertex exactly once.
+  // Queries at equal x run from bottom to top, so a contour found below a
+  // query point is always located already.
+  enum event_kind { REMOVE = 0, INSERT = 1, QUERY = 2 };
+
+  struct event {
+    int64 x;
+    // leftmost y for QUERY, unused otherwise.
+    int64 y;
+    int kind;
+    // segment index for REMOVE/INSERT, contour index for QUERY.
+    int index;
+    bool operator<(const event& that) const {
+      if (x != that.x) {
+        return x < that.x;
+      }
+      if (kind != that.kind) {
+        return kind < that.kind;
+      }
+      return y < that.y;
+    }
+  };
+
+  void collect(const contour_arena& contours) {
+    std::size_t num_contours = contours.size();
+    parent_.assign(num_contours, -1);
+    depth_.assign(num_contours, 0);
+    area_sign_.resize(num_contours);
+    leftmost_.resize(num_contours);
+    segments_.clear();
+    segments_.reserve(contours.num_vertices());
+
+    for (std::size_t c = 0; c < num_contours; ++c) {
+      const std::int32_t* xs = contours.xs(c);
+      const std::int32_t* ys = contours.ys(c);
+      std::size_t n = contours.size(c);
+      vertex leftmost = {xs[0], ys[0]};
+      for (std::size_t j = 0; j < n; ++j) {
+        std::size_t k = (j + 1 == n) ? 0 : j + 1;
+        vertex a = {xs[j], ys[j]};
+        vertex b = {xs[k], ys[k]};
+        if (a < leftmost) {
+          leftmost = a;
+        }
+        // vertical segments are covered by their neighbours.
+        if (a.x == b.x) {
+          continue;
+        }
+        sweep_segment s;
+        s.forward = a.x < b.x;
+        s.left = s.forward ? a : b;
+        s.right = s.forward ? b : a;
+        s.contour = static_cast<int>(c);
+        s.id = static_cast<int>(segments_.size());
+        segments_.push_back(s);
+      }
+      area_sign_[c] = contours.orientation(c);
+      leftmost_[c] = leftmost;
+    }
+
+    events_.clear();
+    events_.reserve(2 * segments_.size() + num_contours);
+    for (std::size_t i = 0; i < segments_.size(); ++i) {
+      event insert = { segments_[i].left.x, 0, INSERT, static_cast<int>(i) };
+      event remove = { segments_[i].right.x, 0, REMOVE, static_cast<int>(i) };
+      events_.push_back(insert);
+      events_.push_back(remove);
+    }
+    for (std::size_t c = 0; c < num_contours; ++c) {
+      event query = { leftmost_[c].x, leftmost_[c].y, QUERY,
+                      static_cast<int>(c) };
+      events_.push_back(query);
+    }
+    std::sort(events_.begin(), events_.end());
+  }
+
+  void sweep() {
+    pool_allocator<const sweep_segment*> allocator(&pool_);
+    status_type status(below(), allocator);
+    position_.resize(segments_.size());
+    for (const auto& e : events_) {
+      if (e.kind == INSERT) {
+        position_[e.index] = status.insert(&segments_[e.index]).first;
+      } else if (e.kind == REMOVE) {
+        status.erase(position_[e.index]);
+      } else {
+        locate(status, e.index);
+      }
+    }
+  }
+
+  void locate(const status_type& status, int contour) {
+    sweep_segment probe;
+    probe.left = probe.right = leftmost_[contour];
+    probe.id = INT_MAX;
+    status_type::const_iterator it = status.lower_bound(&probe);
+    // the segments of the contour itself start at the probe and compare
+    // below it, skip them.
+    do {
+      if (it == status.begin()) {
+        return;
+      }
+      --it;
+    } while ((*it)->contour == contour);
+    const sweep_segment& s = **it;
+    // A counter-clockwise contour has its interior on the left of each
+    // directed edge, which is above the edge when it runs left to right.
+    bool interior_above = (area_sign_[s.contour] > 0) == s.forward;
+    int p = interior_above ? s.contour : parent_[s.contour];
+    parent_[contour] = p;
+    depth_[contour] = (p == -1) ? 0 : depth_[p] + 1;
+  }
+
+  std::vector<sweep_segment> segments_;
+  std::vector<event> events_;
+  std::vector<vertex> leftmost_;
+  std::vector<int> area_sign_;
+  std::vector<int> parent_;
+  std::vector<int> depth_;
+  // where each segment sits in the status while it is active.
+  std::vector<status_type::iterator> position_;
+  node_pool pool_;
+};
+
+#endif  // NESTING_SWEEP_HPP
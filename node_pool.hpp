@@ -0,0 +1,123 @@
+#ifndef NODE_POOL_HPP
+#define NODE_POOL_HPP
+
+#include <cstddef>
+#include <new>
+#include <vector>
+
+// Recycles the nodes of node-based containers like std::set, which
+// otherwise go to the heap on every insert and back on every erase. Nodes
+// are carved from chunks that are kept until the pool is destroyed, freed
+// nodes are put on a free list of their size. A container filled and
+// emptied again and again, or a new one on the same pool, then allocates
+// only when it holds more nodes than ever before. Not thread safe.
+class node_pool {
+ public:
+  node_pool() : capacity_bytes_(0) {}
+  ~node_pool() {
+    for (void* chunk : chunks_) {
+      ::operator delete(chunk);
+    }
+  }
+
+  void* allocate(std::size_t size) {
+    size_class& c = find(size);
+    if (c.free != NULL) {
+      free_node* node = c.free;
+      c.free = node->next;
+      return node;
+    }
+    if (c.next == c.end) {
+      // chunks double with the nodes of the size already carved.
+      std::size_t count = c.carved < MIN_CHUNK ? MIN_CHUNK : c.carved;
+      c.next = static_cast<char*>(::operator new(count * c.size));
+      c.end = c.next + count * c.size;
+      chunks_.push_back(c.next);
+      capacity_bytes_ += count * c.size;
+      c.carved += count;
+    }
+    void* node = c.next;
+    c.next += c.size;
+    return node;
+  }
+
+  void deallocate(void* p, std::size_t size) {
+    size_class& c = find(size);
+    free_node* node = static_cast<free_node*>(p);
+    node->next = c.free;
+    c.free = node;
+  }
+
+  // Bytes held in chunks.
+  std::size_t capacity_bytes() const { return capacity_bytes_; }
+
+ private:
+  struct free_node {
+    free_node* next;
+  };
+
+  // the nodes of one size, of which a container has only a few.
+  struct size_class {
+    std::size_t size;
+    free_node* free;
+    char* next;
+    char* end;
+    std::size_t carved;
+  };
+
+  static const std::size_t MIN_CHUNK = 64;
+
+  size_class& find(std::size_t size) {
+    const std::size_t align = alignof(std::max_align_t);
+    size = size < sizeof(free_node) ? sizeof(free_node) : size;
+    size = (size + align - 1) / align * align;
+    for (auto& c : classes_) {
+      if (c.size == size) {
+        return c;
+      }
+    }
+    size_class c = {size, NULL, NULL, NULL, 0};
+    classes_.push_back(c);
+    return classes_.back();
+  }
+
+  node_pool(const node_pool&);
+  node_pool& operator=(const node_pool&);
+
+  std::vector<size_class> classes_;
+  std::vector<void*> chunks_;
+  std::size_t capacity_bytes_;
+};
+
+// Standard allocator taking its memory from a node_pool, which must outlive
+// the containers using it.
+template <typename T>
+class pool_allocator {
+ public:
+  typedef T value_type;
+
+  explicit pool_allocator(node_pool* pool) : pool_(pool) {}
+  template <typename U>
+  pool_allocator(const pool_allocator<U>& that) : pool_(that.pool()) {}
+
+  T* allocate(std::size_t n) {
+    return static_cast<T*>(pool_->allocate(n * sizeof(T)));
+  }
+  void deallocate(T* p, std::size_t n) { pool_->deallocate(p, n * sizeof(T)); }
+
+  node_pool* pool() const { return pool_; }
+
+  template <typename U>
+  bool operator==(const pool_allocator<U>& that) const {
+    return pool_ == that.pool();
+  }
+  template <typename U>
+  bool operator!=(const pool_allocator<U>& that) const {
+    return pool_ != that.pool();
+  }
+
+ private:
+  node_pool* pool_;
+};
+
+#endif  // NODE_POOL_HPP
@@ -0,0 +1,28 @@
+#ifndef PERCENTILE_HPP
+#define PERCENTILE_HPP
+
+#include <cstddef>
+#include <vector>
+
+// The p-th percentile of sorted by nearest rank: the smallest sample that
+// at least p percent of the samples do not exceed, the least for p = 0.
+// sorted must not be empty.
+inline double percentile(const std::vector<double>& sorted, double p) {
+  std::size_t n = sorted.size();
+  // p * n / 100 rather than p / 100 * n, which is exact whenever the rank
+  // is a whole number.
+  double exact = p * static_cast<double>(n) / 100.0;
+  std::size_t rank = static_cast<std::size_t>(exact);
+  if (static_cast<double>(rank) < exact) {
+    ++rank;
+  }
+  if (rank < 1) {
+    rank = 1;
+  }
+  if (rank > n) {
+    rank = n;
+  }
+  return sorted[rank - 1];
+}
+
+#endif  // PERCENTILE_HPP
@@ -0,0 +1,253 @@
+// Checks add_contour, remove_contour and move_contour of LayoutClassifier:
+// random edits of the layouts below the directory given, each followed by
+// a comparison of the contour depths and the regions with those of a
+// layout built afresh from the edited segments.
+//
+// usage: contour_edit_test <input_data directory>
+
+#include <algorithm>
+#include <cstdint>
+#include <random>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "LayoutClassifier.h"
+#include "test_support.hpp"
+
+namespace {
+
+typedef std::vector<std::pair<int, int> > ring;
+typedef std::multiset<std::pair<ring, std::multiset<ring> > > region_set;
+
+// The vertices of a polygon starting from the least, as the regions of
+// the two layouts may start anywhere.
+template <typename Polygon>
+ring normalized(const Polygon& polygon) {
+  ring r;
+  for (const auto& p : polygon) {
+    r.push_back(std::make_pair(p.x(), p.y()));
+  }
+  std::rotate(r.begin(), std::min_element(r.begin(), r.end()), r.end());
+  return r;
+}
+
+region_set regions(const LayoutClassifier& layout) {
+  region_set result;
+  for (const auto& region : layout.combined_polygon_set()) {
+    poly_type outer;
+    outer.set(region.begin(), region.end());
+    std::multiset<ring> holes;
+    for (auto hole = region.begin_holes(); hole != region.end_holes();
+         ++hole) {
+      holes.insert(normalized(*hole));
+    }
+    result.insert(std::make_pair(normalized(outer), holes));
+  }
+  return result;
+}
+
+// Tells whether the closed contour through vertices meets none of the
+// segments of layout, but those in [skip_begin, skip_end).
+bool clear_of(const LayoutClassifier& layout,
+              const std::vector<point_type>& vertices,
+              std::size_t skip_begin = 0, std::size_t skip_end = 0) {
+  const std::vector<segment_type>& segments = layout.segment_data();
+  for (std::size_t v = 0; v < vertices.size(); ++v) {
+    segment_type edge(vertices[v], vertices[(v + 1) % vertices.size()]);
+    for (std::size_t s = 0; s < segments.size(); ++s) {
+      if ((s < skip_begin || s >= skip_end) &&
+          intersects(edge, segments[s], true)) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+bool in_range(std::int64_t value) {
+  return value >= INT32_MIN && value <= INT32_MAX;
+}
+
+std::vector<point_type> rectangle(std::int64_t x1, std::int64_t y1,
+                                  std::int64_t x2, std::int64_t y2) {
+  std::vector<point_type> vertices;
+  if (!in_range(x1) || !in_range(y1) || !in_range(x2) || !in_range(y2)) {
+    return vertices;
+  }
+  vertices.push_back(point_type(static_cast<int>(x1), static_cast<int>(y1)));
+  vertices.push_back(point_type(static_cast<int>(x2), static_cast<int>(y1)));
+  vertices.push_back(point_type(static_cast<int>(x2), static_cast<int>(y2)));
+  vertices.push_back(point_type(static_cast<int>(x1), static_cast<int>(y2)));
+  return vertices;
+}
+
+void compare_with_rebuild(const LayoutClassifier& layout,
+                          const std::string& what) {
+  LayoutClassifier fresh;
+  fresh.reserve_segments(layout.segment_data().size());
+  for (const auto& s : layout.segment_data()) {
+    fresh.add_segment(low(s).x(), low(s).y(), high(s).x(), high(s).y());
+  }
+  fresh.build();
+  const std::vector<int>& found = layout.contour_depth();
+  const std::vector<int>& expected = fresh.contour_depth();
+  EXPECT(found.size() == expected.size(),
+         what << ": " << found.size() << " contours, expected "
+              << expected.size());
+  for (std::size_t c = 0; c < expected.size() && c < found.size(); ++c) {
+    EXPECT(found[c] == expected[c], what << ": contour " << c
+                                         << " has depth " << found[c]
+                                         << ", expected " << expected[c]);
+  }
+  EXPECT(regions(layout) == regions(fresh),
+         what << ": " << layout.combined_polygon_set().size()
+              << " regions, expected "
+              << fresh.combined_polygon_set().size());
+}
+
+// Applies edits random edits to layout, each checked against a rebuild.
+// Added and moved contours that would meet another one are drawn again, up
+// to a bounded number of times.
+void check_edits(LayoutClassifier* layout, const std::string& file,
+                 int edits, std::mt19937_64* random) {
+  auto uniform = [&](std::int64_t lo, std::int64_t hi) {
+    return std::uniform_int_distribution<std::int64_t>(lo, hi)(*random);
+  };
+  const rect_type& box = layout->brect();
+  std::int64_t w = static_cast<std::int64_t>(xh(box)) - xl(box) + 1;
+  std::int64_t h = static_cast<std::int64_t>(yh(box)) - yl(box) + 1;
+  int done = 0;
+  for (int attempt = 0; attempt < 20 * edits && done < edits; ++attempt) {
+    const contour_arena& contours = layout->contours();
+    std::size_t n = contours.size();
+    int kind = static_cast<int>(uniform(0, 3));
+    std::string what;
+    bool edited = false;
+    if (kind == 0 && n > 0) {
+      std::size_t c = static_cast<std::size_t>(uniform(0, n - 1));
+      what = "remove " + std::to_string(c);
+      edited = layout->remove_contour(c);
+    } else if (kind == 1) {
+      // a square anywhere in and around the layout.
+      std::int64_t side = uniform(1, (std::max<std::int64_t>)(
+                                         1, (std::min)(w, h) / 4));
+      std::int64_t x = xl(box) + uniform(-side, w);
+      std::int64_t y = yl(box) + uniform(-side, h);
+      std::vector<point_type> vertices =
+          rectangle(x, y, x + side, y + side);
+      if (vertices.empty() || !clear_of(*layout, vertices)) {
+        continue;
+      }
+      if (uniform(0, 1) == 0) {
+        std::reverse(vertices.begin(), vertices.end());
+      }
+      what = "add";
+      edited = layout->add_contour(vertices);
+    } else if (kind == 2 && n > 0) {
+      std::size_t c = static_cast<std::size_t>(uniform(0, n - 1));
+      std::int64_t dx = uniform(-w / 4, w / 4);
+      std::int64_t dy = uniform(-h / 4, h / 4);
+      std::vector<point_type> vertices;
+      for (std::size_t v = 0; v < contours.size(c); ++v) {
+        std::int64_t x = contours.xs(c)[v] + dx;
+        std::int64_t y = contours.ys(c)[v] + dy;
+        if (!in_range(x) || !in_range(y)) {
+          vertices.clear();
+          break;
+        }
+        vertices.push_back(
+            point_type(static_cast<int>(x), static_cast<int>(y)));
+      }
+      std::size_t begin = contours.begin(c);
+      if (vertices.empty() ||
+          !clear_of(*layout, vertices, begin, begin + contours.size(c))) {
+        continue;
+      }
+      what = "move " + std::to_string(c);
+      edited = layout->move_contour(c, static_cast<int>(dx),
+                                    static_cast<int>(dy));
+    } else if (kind == 3 && n > 0) {
+      // a rectangle just around a contour, which deepens its subtree.
+      std::size_t c = static_cast<std::size_t>(uniform(0, n - 1));
+      const contour_arena::box& b = contours.bounds(c);
+      std::int64_t m = uniform(1, 3);
+      std::vector<point_type> vertices = rectangle(
+          b.xl - m, b.yl - m, static_cast<std::int64_t>(b.xh) + m,
+          static_cast<std::int64_t>(b.yh) + m);
+      if (vertices.empty() || !clear_of(*layout, vertices)) {
+        continue;
+      }
+      what = "enclose " + std::to_string(c);
+      edited = layout->add_contour(vertices);
+    } else {
+      continue;
+    }
+    what = file + ": edit " + std::to_string(done) + ", " + what;
+    EXPECT(edited, what);
+    compare_with_rebuild(*layout, what);
+    ++done;
+  }
+  EXPECT(done == edits, file << ": " << done << " of " << edits << " edits");
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  if (argc != 2) {
+    std::cerr << "usage: contour_edit_test <input_data directory>\n";
+    return 2;
+  }
+  std::mt19937_64 random(1);
+  std::vector<std::string> files = layout_files(argv[1]);
+  EXPECT(!files.empty(), "no layouts below " << argv[1]);
+  for (const auto& file : files) {
+    LayoutClassifier layout;
+    std::string error;
+    if (!layout.read_data(file, &error)) {
+      EXPECT(false, error);
+      continue;
+    }
+    EXPECT(layout.build(), file);
+    if (layout.empty()) {
+      continue;
+    }
+    check_edits(&layout, file, 30, &random);
+  }
+
+  // moves that would leave the coordinate range are refused and change
+  // nothing, up to the very edge of it they are made.
+  LayoutClassifier nested;
+  for (const auto& square :
+       {rectangle(-100, -100, 100, 100), rectangle(10, 10, 20, 20)}) {
+    for (std::size_t v = 0; v < square.size(); ++v) {
+      const point_type& next = square[(v + 1) % square.size()];
+      nested.add_segment(square[v].x(), square[v].y(), next.x(), next.y());
+    }
+  }
+  EXPECT(nested.build(), "nested squares");
+  const std::vector<segment_type> before = nested.segment_data();
+  EXPECT(!nested.move_contour(1, INT32_MAX - 19, 0), "past the right");
+  EXPECT(!nested.move_contour(1, 0, INT32_MAX), "past the top");
+  EXPECT(!nested.move_contour(0, INT32_MIN + 99, 0), "past the left");
+  EXPECT(!nested.move_contour(0, 0, INT32_MIN), "past the bottom");
+  EXPECT(nested.segment_data() == before, "refused moves");
+  compare_with_rebuild(nested, "refused moves");
+  EXPECT(nested.contour_depth() == std::vector<int>({0, 1}),
+         "refused moves");
+  EXPECT(nested.move_contour(1, INT32_MAX - 20, INT32_MIN + 10),
+         "to the edge");
+  compare_with_rebuild(nested, "to the edge");
+  EXPECT(nested.contour_depth() == std::vector<int>({0, 0}), "to the edge");
+
+  // editing a layout that was never built is refused.
+  LayoutClassifier unbuilt;
+  unbuilt.add_segment(0, 0, 10, 0);
+  unbuilt.add_segment(10, 0, 10, 10);
+  unbuilt.add_segment(10, 10, 0, 0);
+  EXPECT(!unbuilt.add_contour(rectangle(20, 20, 30, 30)), "unbuilt add");
+  EXPECT(!unbuilt.remove_contour(0), "unbuilt remove");
+  EXPECT(!unbuilt.move_contour(0, 1, 1), "unbuilt move");
+  return test_result();
+}
@@ -0,0 +1,135 @@
+// Checks wide_int, cross() and cross_sign() of exact_predicates.hpp: the
+// portable split_product() against product(), sums of products against
+// __int128 where the compiler has it, and signs that double arithmetic
+// gets wrong.
+//
+// usage: exact_predicates_test
+
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <random>
+#include <vector>
+
+#include "exact_predicates.hpp"
+#include "test_support.hpp"
+
+namespace {
+
+const std::int64_t MIN64 = (std::numeric_limits<std::int64_t>::min)();
+const std::int64_t MAX64 = (std::numeric_limits<std::int64_t>::max)();
+
+// to_double() rounds twice, once for each half.
+bool near(double value, double expected) {
+  return std::fabs(value - expected) <= std::fabs(expected) * 0x1p-51;
+}
+
+int sign_of(const wide_int& a, const wide_int& b) {
+  wide_int d = a;
+  d -= b;
+  return d.sign();
+}
+
+void check_product(std::int64_t a, std::int64_t b) {
+  wide_int p = wide_int::product(a, b);
+  wide_int s = wide_int::split_product(a, b);
+  EXPECT(sign_of(p, s) == 0, a << " * " << b);
+  int expected = (a == 0 || b == 0) ? 0 : ((a < 0) != (b < 0) ? -1 : 1);
+  EXPECT(p.sign() == expected, a << " * " << b);
+#if defined(__SIZEOF_INT128__)
+  __int128 reference = static_cast<__int128>(a) * b;
+  EXPECT(near(p.to_double(), static_cast<double>(reference)),
+         a << " * " << b);
+#endif
+}
+
+}  // namespace
+
+int main() {
+  const std::int64_t edges[] = {
+      0, 1, -1, 2, -2, 0xffffffffLL, -0xffffffffLL, 0x100000000LL,
+      -0x100000000LL, 0x1ffffffffLL, -0x1ffffffffLL, MAX64, MIN64,
+      MIN64 + 1, MAX64 - 1};
+  for (std::int64_t a : edges) {
+    for (std::int64_t b : edges) {
+      check_product(a, b);
+    }
+  }
+
+  std::mt19937_64 random(1);
+  std::uniform_int_distribution<int> bits(0, 63);
+  for (int k = 0; k < 100000; ++k) {
+    // magnitudes of every size, not just the large ones uniform values
+    // would give.
+    std::int64_t a = static_cast<std::int64_t>(random() >> bits(random));
+    std::int64_t b = static_cast<std::int64_t>(random() >> bits(random));
+    check_product(k & 1 ? -a : a, k & 2 ? -b : b);
+  }
+
+  // differences of 32-bit coordinates, 33 bits, whose products differ by
+  // less than double can tell apart.
+  const std::int64_t big = 0xffffffffLL;
+  EXPECT(cross_sign(big, big - 1, big - 1, big - 2) == -1,
+         "(2^32 - 1)(2^32 - 3) - (2^32 - 2)^2");
+  EXPECT(cross_sign(big - 1, big, big - 2, big - 1) == 1,
+         "(2^32 - 2)^2 - (2^32 - 1)(2^32 - 3)");
+  EXPECT(cross_sign(-big, big, big, -big) == 0, "parallel");
+  EXPECT(cross_sign(2 * big, -2 * big, 2 * big, 2 * big) == 1,
+         "counter-clockwise");
+
+  std::uniform_int_distribution<std::int64_t> coordinate(
+      -(std::int64_t(1) << 33), std::int64_t(1) << 33);
+  for (int k = 0; k < 100000; ++k) {
+    std::int64_t ux = coordinate(random), uy = coordinate(random);
+    std::int64_t vx = coordinate(random), vy = coordinate(random);
+    if (k % 3 == 0) {
+      // nearly parallel.
+      vx = ux + (k % 5) - 2;
+      vy = uy + (k % 7) - 3;
+    }
+    int sign = cross_sign(ux, uy, vx, vy);
+    EXPECT(sign == cross(ux, uy, vx, vy).sign(),
+           ux << " " << uy << " " << vx << " " << vy);
+    EXPECT(sign == -cross_sign(vx, vy, ux, uy),
+           ux << " " << uy << " " << vx << " " << vy);
+    wide_int split = wide_int::split_product(ux, vy);
+    split -= wide_int::split_product(uy, vx);
+    EXPECT(sign == split.sign(), ux << " " << uy << " " << vx << " " << vy);
+  }
+
+  // twice the area of a contour, summed over many edges of 32-bit
+  // coordinates, beyond 64 bits.
+  std::uniform_int_distribution<std::int64_t> vertex(INT32_MIN, INT32_MAX);
+  for (int k = 0; k < 100; ++k) {
+    std::vector<std::int64_t> xs(1000), ys(1000);
+    for (std::size_t i = 0; i < xs.size(); ++i) {
+      xs[i] = vertex(random);
+      ys[i] = vertex(random);
+    }
+    wide_int area;
+#if defined(__SIZEOF_INT128__)
+    __int128 reference = 0;
+#endif
+    for (std::size_t i = 0; i < xs.size(); ++i) {
+      std::size_t j = (i + 1) % xs.size();
+      area += cross(xs[i], ys[i], xs[j], ys[j]);
+#if defined(__SIZEOF_INT128__)
+      reference += static_cast<__int128>(xs[i]) * ys[j] -
+                   static_cast<__int128>(ys[i]) * xs[j];
+#endif
+    }
+#if defined(__SIZEOF_INT128__)
+    EXPECT(area.sign() == (reference > 0) - (reference < 0), k);
+    EXPECT(near(area.to_double(), static_cast<double>(reference)), k);
+#endif
+    // reversed, the same area with the opposite sign.
+    wide_int reversed;
+    for (std::size_t i = 0; i < xs.size(); ++i) {
+      std::size_t j = (i + 1) % xs.size();
+      reversed += cross(xs[j], ys[j], xs[i], ys[i]);
+    }
+    reversed += area;
+    EXPECT(reversed.sign() == 0, k);
+  }
+  return test_result();
+}
@@ -0,0 +1,26 @@
+# Generates a layout large enough to be split into groups and checks its
+# nesting built on four threads with both engines, against the depths the
+# generator wrote. Run by ctest as
+#   cmake -DGENERATE=<material_generate> -DLAYOUT=<path> -P <this file>
+
+execute_process(COMMAND ${GENERATE} -n 10000 -o ${LAYOUT}
+        RESULT_VARIABLE result)
+if(NOT result EQUAL 0)
+    message(FATAL_ERROR "material_generate failed to write ${LAYOUT}")
+endif()
+
+foreach(engine sweep voronoi)
+    execute_process(
+            COMMAND ${GENERATE} --check --engine ${engine} --threads 4
+                    ${LAYOUT}
+            RESULT_VARIABLE result
+            OUTPUT_VARIABLE report)
+    message(STATUS "${engine}: ${report}")
+    if(NOT result EQUAL 0)
+        message(FATAL_ERROR "${engine}: wrong depths on four threads")
+    endif()
+    # a layout built on one thread would not test the groups.
+    if(report MATCHES " 0 groups")
+        message(FATAL_ERROR "${engine}: the layout was not split")
+    endif()
+endforeach()
@@ -0,0 +1,294 @@
+// Checks the contour depths of LayoutClassifier: on the layouts below the
+// directory given against a brute force count of the contours containing
+// each contour, and on random layouts of nested contours, at small and at
+// large coordinates, against the depths they were made with.
+//
+// usage: nesting_test <input_data directory>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "LayoutClassifier.h"
+#include "point_in_contour.hpp"
+#include "test_support.hpp"
+
+namespace {
+
+const double PI = 3.14159265358979323846;
+
+struct engine_case {
+  const char* name;
+  LayoutClassifier::nesting_engine engine;
+};
+
+const engine_case ENGINES[] = {
+    {"sweep", LayoutClassifier::SWEEP_NESTING},
+    {"voronoi", LayoutClassifier::VORONOI_NESTING},
+};
+
+// Tells whether contour inner of arena lies inside contour outer, the
+// contours do not cross. The first vertex off the boundary decides, as
+// they may touch.
+bool contains(const contour_arena& arena, std::size_t outer,
+              std::size_t inner) {
+  const contour_arena::box& o = arena.bounds(outer);
+  const contour_arena::box& i = arena.bounds(inner);
+  if (i.xl < o.xl || i.xh > o.xh || i.yl < o.yl || i.yh > o.yh) {
+    return false;
+  }
+  for (std::size_t v = 0; v < arena.size(inner); ++v) {
+    int side = point_in_contour::locate(arena.xs(outer), arena.ys(outer),
+                                        arena.size(outer),
+                                        arena.xs(inner)[v],
+                                        arena.ys(inner)[v]);
+    if (side != 0) {
+      return side > 0;
+    }
+  }
+  return false;
+}
+
+std::vector<int> brute_force_depths(const contour_arena& arena) {
+  std::vector<int> depths(arena.size(), 0);
+  for (std::size_t inner = 0; inner < arena.size(); ++inner) {
+    for (std::size_t outer = 0; outer < arena.size(); ++outer) {
+      if (outer != inner && contains(arena, outer, inner)) {
+        ++depths[inner];
+      }
+    }
+  }
+  return depths;
+}
+
+void compare_depths(const std::string& what, const std::vector<int>& found,
+                    const std::vector<int>& expected) {
+  EXPECT(found.size() == expected.size(),
+         what << ": " << found.size() << " contours, expected "
+              << expected.size());
+  for (std::size_t c = 0; c < expected.size() && c < found.size(); ++c) {
+    EXPECT(found[c] == expected[c], what << ": contour " << c
+                                         << " has depth " << found[c]
+                                         << ", expected " << expected[c]);
+  }
+}
+
+struct contour {
+  std::vector<point_type> vertices;
+  int depth;
+};
+
+// A layout of islands, each a tree of contours. Every contour lies in a
+// circle, its children in disjoint circles within the inner 0.42 of its
+// radius, which the contour surely encloses. Contours are stars with
+// vertices spread around the circle or squares with extra vertices along
+// their edges, so that many edges are collinear.
+class random_layout {
+ public:
+  random_layout(unsigned seed, double scale) : random_(seed), scale_(scale) {}
+
+  std::vector<contour> make() {
+    contours_.clear();
+    std::vector<circle> islands;
+    place(0.0, 0.0, scale_, 8, &islands);
+    for (const auto& island : islands) {
+      grow(island, 0);
+    }
+    // the classifier must not depend on the order of the contours, their
+    // first vertex or their orientation.
+    std::shuffle(contours_.begin(), contours_.end(), random_);
+    for (auto& c : contours_) {
+      std::rotate(c.vertices.begin(),
+                  c.vertices.begin() + uniform(c.vertices.size()),
+                  c.vertices.end());
+      if (uniform(2) == 0) {
+        std::reverse(c.vertices.begin(), c.vertices.end());
+      }
+    }
+    return contours_;
+  }
+
+ private:
+  struct circle {
+    double x, y, r;
+  };
+
+  std::size_t uniform(std::size_t n) {
+    return std::uniform_int_distribution<std::size_t>(0, n - 1)(random_);
+  }
+  double unit() {
+    return std::uniform_real_distribution<double>(0.0, 1.0)(random_);
+  }
+
+  // Adds up to count disjoint circles within radius of (x, y).
+  void place(double x, double y, double radius, std::size_t count,
+             std::vector<circle>* circles) {
+    for (std::size_t attempt = 0;
+         attempt < 20 * count && circles->size() < count; ++attempt) {
+      circle c;
+      c.r = radius * (0.15 + 0.3 * unit());
+      double distance = (radius - c.r) * unit();
+      double angle = 2 * PI * unit();
+      c.x = x + distance * std::cos(angle);
+      c.y = y + distance * std::sin(angle);
+      bool free = true;
+      for (const auto& other : *circles) {
+        free = free && std::hypot(c.x - other.x, c.y - other.y) >
+                           c.r + other.r + radius * 0.01;
+      }
+      if (free) {
+        circles->push_back(c);
+      }
+    }
+  }
+
+  void grow(const circle& c, int depth) {
+    contour result;
+    result.depth = depth;
+    if (uniform(3) == 0) {
+      // a square inscribed in the circle.
+      double half = c.r * 0.7;
+      std::size_t per_side = 1 + uniform(4);
+      for (int side = 0; side < 4; ++side) {
+        for (std::size_t k = 0; k < per_side; ++k) {
+          double t = -half + 2 * half * k / per_side;
+          double x = side == 0 ? t : side == 2 ? -t : side == 1 ? half : -half;
+          double y = side == 1 ? t : side == 3 ? -t : side == 2 ? half : -half;
+          result.vertices.push_back(point_type(
+              static_cast<int>(std::llround(c.x + x)),
+              static_cast<int>(std::llround(c.y + y))));
+        }
+      }
+    } else {
+      // angles jittered by at most half a step keep every chord, and so
+      // the contour, outside 0.6 * cos(pi / 4) of the radius.
+      std::size_t n = 6 + uniform(11);
+      for (std::size_t k = 0; k < n; ++k) {
+        double angle = 2 * PI * (k + 0.5 * unit()) / n;
+        double r = c.r * (0.6 + 0.4 * unit());
+        result.vertices.push_back(point_type(
+            static_cast<int>(std::llround(c.x + r * std::cos(angle))),
+            static_cast<int>(std::llround(c.y + r * std::sin(angle)))));
+      }
+    }
+    contours_.push_back(result);
+    // the children keep clear of the contour by a tenth of the radius,
+    // far more than the rounding of the vertices.
+    if (depth < 4 && c.r > 1000) {
+      std::vector<circle> children;
+      place(c.x, c.y, c.r * 0.3, uniform(5), &children);
+      for (const auto& child : children) {
+        grow(child, depth + 1);
+      }
+    }
+  }
+
+  std::mt19937_64 random_;
+  double scale_;
+  std::vector<contour> contours_;
+};
+
+// Lattice points as close to a long edge as they get, 1 / |edge| off it:
+// a triangle with one such vertex on either side of the long edge of
+// another triangle, inside a square. The voronoi vertices between them are
+// as close to the edge as vertices off the input get.
+std::vector<contour> near_edge_layout() {
+  const int big = 1000000000;
+  std::vector<contour> contours(4);
+  contours[0].vertices = {point_type(-2 * big, -2 * big),
+                          point_type(2 * big, -2 * big),
+                          point_type(2 * big, 2 * big),
+                          point_type(-2 * big, 2 * big)};
+  contours[0].depth = 0;
+  // the long edge from (-big, 1 - big) to (big, big).
+  contours[1].vertices = {point_type(-big, 1 - big), point_type(big, -big),
+                          point_type(big, big)};
+  contours[1].depth = 1;
+  // 1 above the long edge, outside the triangle.
+  contours[2].vertices = {point_type(1 - big, 2 - big),
+                          point_type(1 - big, 7 - big),
+                          point_type(-4 - big, 7 - big)};
+  contours[2].depth = 1;
+  // 1 below it, inside.
+  contours[3].vertices = {point_type(big - 1, big - 1),
+                          point_type(big - 4, big - 9),
+                          point_type(big - 1, big - 6)};
+  contours[3].depth = 2;
+  return contours;
+}
+
+void add_contours(const std::vector<contour>& contours,
+                  LayoutClassifier* layout) {
+  for (const auto& c : contours) {
+    const std::vector<point_type>& v = c.vertices;
+    for (std::size_t i = 0; i < v.size(); ++i) {
+      const point_type& next = v[(i + 1) % v.size()];
+      layout->add_segment(v[i].x(), v[i].y(), next.x(), next.y());
+    }
+  }
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  if (argc != 2) {
+    std::cerr << "usage: nesting_test <input_data directory>\n";
+    return 2;
+  }
+  std::vector<std::string> files = layout_files(argv[1]);
+  EXPECT(!files.empty(), "no layouts below " << argv[1]);
+  for (const auto& file : files) {
+    for (const auto& e : ENGINES) {
+      LayoutClassifier layout;
+      layout.set_nesting_engine(e.engine);
+      std::string error;
+      if (!layout.read_data(file, &error)) {
+        EXPECT(false, error);
+        continue;
+      }
+      EXPECT(layout.build(), file);
+      compare_depths(file + " " + e.name, layout.contour_depth(),
+                     brute_force_depths(layout.contours()));
+    }
+  }
+
+  // from small contours, where rounding the vertices makes collinear and
+  // axis-parallel edges common, to most of the int32 range.
+  const double scales[] = {2e4, 1e6, 1e9};
+  for (unsigned seed = 1; seed <= 60; ++seed) {
+    double scale = scales[seed % 3];
+    std::vector<contour> contours = random_layout(seed, scale).make();
+    std::vector<int> expected;
+    for (const auto& c : contours) {
+      expected.push_back(c.depth);
+    }
+    for (const auto& e : ENGINES) {
+      LayoutClassifier layout;
+      layout.set_nesting_engine(e.engine);
+      add_contours(contours, &layout);
+      EXPECT(layout.build(), "seed " << seed);
+      std::string what = "seed " + std::to_string(seed) + " " + e.name;
+      compare_depths(what, layout.contour_depth(), expected);
+      compare_depths(what + " brute force",
+                     brute_force_depths(layout.contours()), expected);
+    }
+  }
+
+  std::vector<contour> near_edge = near_edge_layout();
+  std::vector<int> expected;
+  for (const auto& c : near_edge) {
+    expected.push_back(c.depth);
+  }
+  for (const auto& e : ENGINES) {
+    LayoutClassifier layout;
+    layout.set_nesting_engine(e.engine);
+    add_contours(near_edge, &layout);
+    EXPECT(layout.build(), "near edge");
+    compare_depths(std::string("near edge ") + e.name, layout.contour_depth(),
+                   expected);
+  }
+  return test_result();
+}
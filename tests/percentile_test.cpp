@@ -0,0 +1,50 @@
+// Checks percentile() of percentile.hpp, the nearest rank percentiles of
+// the material_bench report, on sample sets whose ranks are known.
+//
+// usage: percentile_test
+
+#include <vector>
+
+#include "percentile.hpp"
+#include "test_support.hpp"
+
+namespace {
+
+// 1, 2, ..., n.
+std::vector<double> samples(int n) {
+  std::vector<double> sorted;
+  for (int k = 1; k <= n; ++k) {
+    sorted.push_back(k);
+  }
+  return sorted;
+}
+
+void check(int n, double p, double expected) {
+  double found = percentile(samples(n), p);
+  EXPECT(found == expected, "p" << p << " of " << n << " samples is "
+                                << found << ", expected " << expected);
+}
+
+}  // namespace
+
+int main() {
+  check(1, 0, 1);
+  check(1, 50, 1);
+  check(1, 100, 1);
+  // whole ranks are the sample at that rank, not the one after it.
+  check(2, 50, 1);
+  check(4, 50, 2);
+  check(10, 90, 9);
+  check(100, 50, 50);
+  check(100, 90, 90);
+  check(100, 99, 99);
+  check(1000, 99, 990);
+  // fractional ranks round up.
+  check(3, 50, 2);
+  check(10, 99, 10);
+  check(11, 90, 10);
+  check(99, 50, 50);
+  check(7, 100, 7);
+  check(7, 0, 1);
+  return test_result();
+}
@@ -0,0 +1,283 @@
+// Checks point_in_contour::locate and locate_scalar against
+// boost::polygon::contains on the contours of the layouts below the
+// directory given, and on random contours: at their vertices, on their
+// edges, on the lines through their vertices and anywhere in their box.
+//
+// usage: point_in_contour_test <input_data directory>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <numeric>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <boost/polygon/polygon.hpp>
+
+#include "LayoutClassifier.h"
+#include "exact_predicates.hpp"
+#include "point_in_contour.hpp"
+#include "test_support.hpp"
+
+namespace {
+
+struct contour {
+  std::vector<std::int32_t> xs;
+  std::vector<std::int32_t> ys;
+};
+
+std::string describe(const contour& c, std::int64_t x, std::int64_t y) {
+  std::ostringstream out;
+  out << "(" << x << ", " << y << ") against";
+  for (std::size_t i = 0; i < c.xs.size(); ++i) {
+    out << " (" << c.xs[i] << ", " << c.ys[i] << ")";
+  }
+  return out.str();
+}
+
+// Boost.Polygon's answer in the convention of point_in_contour.
+int expected_side(const contour& c, std::int32_t x, std::int32_t y) {
+  typedef boost::polygon::point_data<std::int32_t> point;
+  std::vector<point> vertices;
+  for (std::size_t i = 0; i < c.xs.size(); ++i) {
+    vertices.push_back(point(c.xs[i], c.ys[i]));
+  }
+  boost::polygon::polygon_data<std::int32_t> polygon(vertices.begin(),
+                                                     vertices.end());
+  if (boost::polygon::contains(polygon, point(x, y), false)) {
+    return 1;
+  }
+  return boost::polygon::contains(polygon, point(x, y), true) ? 0 : -1;
+}
+
+// expected is checked only where Boost.Polygon is exact, which is not the
+// case for differences of coordinates beyond 31 bits.
+void check_point(const contour& c, std::int32_t x, std::int32_t y,
+                 bool against_boost) {
+  std::size_t n = c.xs.size();
+  int scalar = point_in_contour::locate_scalar(c.xs.data(), c.ys.data(), n,
+                                               x, y);
+  int side = point_in_contour::locate(c.xs.data(), c.ys.data(), n, x, y);
+  EXPECT(side == scalar, describe(c, x, y));
+  if (against_boost) {
+    int expected = expected_side(c, x, y);
+    EXPECT(scalar == expected,
+           describe(c, x, y) << ", expected " << expected << " got "
+                             << scalar);
+  }
+}
+
+template <typename Random>
+void check_contour(const contour& c, const std::vector<contour>& others,
+                   bool against_boost, Random* random) {
+  std::size_t n = c.xs.size();
+  std::int32_t xl = c.xs[0], xh = c.xs[0], yl = c.ys[0], yh = c.ys[0];
+  for (std::size_t i = 0; i < n; ++i) {
+    xl = (std::min)(xl, c.xs[i]);
+    xh = (std::max)(xh, c.xs[i]);
+    yl = (std::min)(yl, c.ys[i]);
+    yh = (std::max)(yh, c.ys[i]);
+    // on the boundary.
+    check_point(c, c.xs[i], c.ys[i], against_boost);
+    EXPECT(point_in_contour::locate(c.xs.data(), c.ys.data(), n, c.xs[i],
+                                    c.ys[i]) == 0,
+           describe(c, c.xs[i], c.ys[i]));
+    std::size_t j = (i + 1 == n) ? 0 : i + 1;
+    std::int64_t dx = static_cast<std::int64_t>(c.xs[j]) - c.xs[i];
+    std::int64_t dy = static_cast<std::int64_t>(c.ys[j]) - c.ys[i];
+    std::int64_t g = std::gcd(dx < 0 ? -dx : dx, dy < 0 ? -dy : dy);
+    if (g > 1) {
+      std::uniform_int_distribution<std::int64_t> step(1, g - 1);
+      std::int64_t k = step(*random);
+      std::int32_t x = static_cast<std::int32_t>(c.xs[i] + dx / g * k);
+      std::int32_t y = static_cast<std::int32_t>(c.ys[i] + dy / g * k);
+      check_point(c, x, y, against_boost);
+      EXPECT(point_in_contour::locate(c.xs.data(), c.ys.data(), n, x, y) ==
+                 0,
+             describe(c, x, y));
+    }
+  }
+  // the vertices of the other contours, which may touch this one.
+  for (const auto& other : others) {
+    for (std::size_t i = 0; i < other.xs.size(); ++i) {
+      check_point(c, other.xs[i], other.ys[i], against_boost);
+    }
+  }
+  // on the lines through the vertices, where the ray meets them, and off
+  // them by one.
+  std::uniform_int_distribution<std::int32_t> any_x(xl, xh);
+  std::uniform_int_distribution<std::int32_t> any_y(yl, yh);
+  std::uniform_int_distribution<std::size_t> any_vertex(0, n - 1);
+  std::uniform_int_distribution<int> offset(-1, 1);
+  for (int k = 0; k < 64; ++k) {
+    std::int32_t x = any_x(*random);
+    std::int32_t y = any_y(*random);
+    if (k % 4 == 1) {
+      y = c.ys[any_vertex(*random)];
+    } else if (k % 4 == 2) {
+      x = c.xs[any_vertex(*random)];
+    } else if (k % 4 == 3) {
+      std::size_t v = any_vertex(*random);
+      std::int64_t ox = static_cast<std::int64_t>(c.xs[v]) + offset(*random);
+      std::int64_t oy = static_cast<std::int64_t>(c.ys[v]) + offset(*random);
+      if (ox < INT32_MIN || ox > INT32_MAX || oy < INT32_MIN ||
+          oy > INT32_MAX) {
+        continue;
+      }
+      x = static_cast<std::int32_t>(ox);
+      y = static_cast<std::int32_t>(oy);
+    }
+    check_point(c, x, y, against_boost);
+  }
+}
+
+// Tells whether the closed contour has no repeated vertex and no two edges
+// meeting except consecutive ones at their shared vertex.
+bool is_simple(const contour& c) {
+  std::size_t n = c.xs.size();
+  auto side = [&](std::size_t a, std::size_t b, std::size_t p) {
+    return cross_sign(static_cast<std::int64_t>(c.xs[b]) - c.xs[a],
+                      static_cast<std::int64_t>(c.ys[b]) - c.ys[a],
+                      static_cast<std::int64_t>(c.xs[p]) - c.xs[a],
+                      static_cast<std::int64_t>(c.ys[p]) - c.ys[a]);
+  };
+  auto on_box = [&](std::size_t a, std::size_t b, std::size_t p) {
+    return (std::min)(c.xs[a], c.xs[b]) <= c.xs[p] &&
+           c.xs[p] <= (std::max)(c.xs[a], c.xs[b]) &&
+           (std::min)(c.ys[a], c.ys[b]) <= c.ys[p] &&
+           c.ys[p] <= (std::max)(c.ys[a], c.ys[b]);
+  };
+  for (std::size_t i = 0; i < n; ++i) {
+    for (std::size_t j = i + 1; j < n; ++j) {
+      if (c.xs[i] == c.xs[j] && c.ys[i] == c.ys[j]) {
+        return false;
+      }
+    }
+  }
+  for (std::size_t i = 0; i < n; ++i) {
+    std::size_t i2 = (i + 1) % n;
+    for (std::size_t j = i + 1; j < n; ++j) {
+      std::size_t j2 = (j + 1) % n;
+      if (j == i2 || j2 == i) {
+        // consecutive edges only share their vertex unless they fold back.
+        std::size_t shared = j == i2 ? j : i;
+        std::size_t a = j == i2 ? i : j;
+        std::size_t b = j == i2 ? j2 : i2;
+        if (side(a, shared, b) == 0 &&
+            (on_box(a, shared, b) || on_box(shared, b, a))) {
+          return false;
+        }
+        continue;
+      }
+      int s1 = side(i, i2, j), s2 = side(i, i2, j2);
+      int s3 = side(j, j2, i), s4 = side(j, j2, i2);
+      if (s1 * s2 < 0 && s3 * s4 < 0) {
+        return false;
+      }
+      if ((s1 == 0 && on_box(i, i2, j)) || (s2 == 0 && on_box(i, i2, j2)) ||
+          (s3 == 0 && on_box(j, j2, i)) || (s4 == 0 && on_box(j, j2, i2))) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+// A star-shaped contour around a random center, or a staircase whose
+// horizontal and vertical edges share their lines.
+template <typename Random>
+contour random_contour(Random* random, std::int64_t radius, bool staircase) {
+  std::uniform_int_distribution<int> vertices(3, 40);
+  std::uniform_real_distribution<double> unit(0.0, 1.0);
+  // the staircase may take up to 14 more.
+  std::int64_t limit = INT32_MAX - radius - 64;
+  std::uniform_int_distribution<std::int64_t> center(-limit, limit);
+  std::int64_t cx = center(*random), cy = center(*random);
+  contour c;
+  if (staircase) {
+    // steps up to the right, then back along the top and the left side.
+    int steps = vertices(*random) / 3 + 1;
+    std::int64_t step = (std::max<std::int64_t>)(radius / steps, 1);
+    for (int s = 0; s < steps; ++s) {
+      c.xs.push_back(static_cast<std::int32_t>(cx + s * step));
+      c.ys.push_back(static_cast<std::int32_t>(cy + s * step));
+      c.xs.push_back(static_cast<std::int32_t>(cx + (s + 1) * step));
+      c.ys.push_back(static_cast<std::int32_t>(cy + s * step));
+    }
+    c.xs.push_back(static_cast<std::int32_t>(cx + steps * step));
+    c.ys.push_back(static_cast<std::int32_t>(cy + steps * step));
+    c.xs.push_back(static_cast<std::int32_t>(cx));
+    c.ys.push_back(static_cast<std::int32_t>(cy + steps * step));
+  } else {
+    int n = vertices(*random);
+    std::vector<double> angles(n);
+    for (auto& angle : angles) {
+      angle = unit(*random) * 6.283185307179586;
+    }
+    std::sort(angles.begin(), angles.end());
+    for (double angle : angles) {
+      double r = radius * (0.1 + 0.9 * unit(*random));
+      c.xs.push_back(static_cast<std::int32_t>(cx + std::llround(
+          r * std::cos(angle))));
+      c.ys.push_back(static_cast<std::int32_t>(cy + std::llround(
+          r * std::sin(angle))));
+    }
+  }
+  if (unit(*random) < 0.5) {
+    std::reverse(c.xs.begin(), c.xs.end());
+    std::reverse(c.ys.begin(), c.ys.end());
+  }
+  return c;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  if (argc != 2) {
+    std::cerr << "usage: point_in_contour_test <input_data directory>\n";
+    return 2;
+  }
+  std::mt19937_64 random(1);
+
+  std::vector<std::string> files = layout_files(argv[1]);
+  EXPECT(!files.empty(), "no layouts below " << argv[1]);
+  for (const auto& file : files) {
+    LayoutClassifier layout;
+    std::string error;
+    if (!layout.read_data(file, &error)) {
+      EXPECT(false, error);
+      continue;
+    }
+    layout.build();
+    const contour_arena& arena = layout.contours();
+    std::vector<contour> contours(arena.size());
+    for (std::size_t i = 0; i < arena.size(); ++i) {
+      contours[i].xs.assign(arena.xs(i), arena.xs(i) + arena.size(i));
+      contours[i].ys.assign(arena.ys(i), arena.ys(i) + arena.size(i));
+    }
+    for (const auto& c : contours) {
+      check_contour(c, contours, true, &random);
+    }
+  }
+
+  // radii from a few units, where the rounding of the star makes
+  // collinear and axis-parallel edges common, to the whole int32 range.
+  const std::int64_t radii[] = {4, 100, 1 << 20, 1 << 29, INT32_MAX / 2};
+  std::size_t simple = 0;
+  for (int k = 0; k < 4000; ++k) {
+    std::int64_t radius = radii[k % 5];
+    contour c = random_contour(&random, radius, k % 3 == 0);
+    if (!is_simple(c)) {
+      continue;
+    }
+    ++simple;
+    // Boost.Polygon is only exact while coordinate differences fit 31
+    // bits.
+    check_contour(c, std::vector<contour>(), radius <= (1 << 29), &random);
+  }
+  EXPECT(simple > 2000, simple << " simple random contours");
+  return test_result();
+}
@@ -0,0 +1,50 @@
+#ifndef TEST_SUPPORT_HPP
+#define TEST_SUPPORT_HPP
+
+#include <algorithm>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// The tests are plain executables run by CTest. A failed EXPECT prints its
+// condition and context and is counted, main returns test_result() so that
+// every failure of a run is reported, not only the first.
+
+inline int& test_failures() {
+  static int failures = 0;
+  return failures;
+}
+
+#define EXPECT(condition, context)                                        \
+  do {                                                                    \
+    if (!(condition)) {                                                   \
+      std::cerr << __FILE__ << ":" << __LINE__ << ": " #condition         \
+                << " failed: " << context << "\n";                        \
+      ++test_failures();                                                  \
+    }                                                                     \
+  } while (false)
+
+inline int test_result() {
+  if (test_failures() != 0) {
+    std::cerr << test_failures() << " checks failed\n";
+    return 1;
+  }
+  return 0;
+}
+
+// The *.txt layouts below directory, in name order.
+inline std::vector<std::string> layout_files(const std::string& directory) {
+  std::vector<std::string> files;
+  std::error_code ec;
+  for (const auto& entry :
+       std::filesystem::recursive_directory_iterator(directory, ec)) {
+    if (entry.is_regular_file() && entry.path().extension() == ".txt") {
+      files.push_back(entry.path().string());
+    }
+  }
+  std::sort(files.begin(), files.end());
+  return files;
+}
+
+#endif  // TEST_SUPPORT_HPP